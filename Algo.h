@@ -1,58 +1,270 @@
 #ifndef AUDIO_ALGO_H
 #define AUDIO_ALGO_H
 
-#include <cassert>
+#include "AudioSequence.h"
+
+#include <algorithm>
 #include <cstdlib>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
 
 namespace audio {
 
+namespace detail {
+  static const size_t smoothChunkSize = 1 << 16; // samples processed per prefix sum pass
+  static const size_t smoothChunksPerWindow = 4; // minimum chunk size relative to window size
+
+  /// moving average of [first, last) of source into smoothed
+  /// @param leftHalo   original samples [first - windowRadius, first) (clipped at 0)
+  /// @param rightHalo  original samples [last, last + windowRadius) (clipped at size)
+  /// @note  only reads source within [first, last), so source and smoothed may alias
+  template<typename Source, typename Destination>
+  void smoothRange(
+      const Source& source,
+      Destination& smoothed,
+      size_t windowRadius,
+      size_t chunkSize,
+      size_t first,
+      size_t last,
+      std::vector<double> leftHalo,
+      const std::vector<double>& rightHalo)
+  {
+    using Value = typename std::iterator_traits<decltype(std::begin(smoothed))>::value_type;
+
+    const auto size = source.size();
+    const auto src = std::begin(source);
+    const auto dst = std::begin(smoothed);
+
+    // original samples [lo, hi) of the current chunk including its halos
+    auto window = std::move(leftHalo);
+    std::vector<double> prefix;
+    std::vector<Value> result;
+
+    for(size_t a = first; a < last;) {
+      const auto b = std::min(a + chunkSize, last);
+      const auto lo = a - window.size();
+      const auto hi = std::min(size, b + windowRadius);
+
+      // samples of this range are not yet overwritten, beyond it use the halo
+      const auto own = std::min(hi, last);
+      (void)window.insert(std::end(window), src + static_cast<std::ptrdiff_t>(a), src + static_cast<std::ptrdiff_t>(own));
+      (void)window.insert(std::end(window), std::begin(rightHalo), std::begin(rightHalo) + static_cast<std::ptrdiff_t>(hi - own));
+
+      // sum of any window is the difference of two prefix sums, accumulated in double to avoid drift
+      prefix.resize(window.size() + 1);
+      prefix[0] = 0.0;
+      (void)std::partial_sum(std::begin(window), std::end(window), std::begin(prefix) + 1);
+
+      result.resize(b - a);
+      const auto average = [&](size_t pos) -> Value {
+        const auto windowFirst = (pos > windowRadius ? pos - windowRadius : 0);
+        const auto windowLast = std::min(size, pos + windowRadius + 1);
+        const auto sum = prefix[windowLast - lo] - prefix[windowFirst - lo];
+        return static_cast<Value>(sum / static_cast<double>(windowLast - windowFirst));
+      };
+
+      // full windows in the interior share one divisor and vectorize
+      const auto interiorFirst = std::min(std::max(a, windowRadius), b);
+      const auto interiorLast = std::max(interiorFirst, std::min(b, size > windowRadius ? size - windowRadius : 0));
+      const auto scale = 1.0 / static_cast<double>(2 * windowRadius + 1);
+      for(auto pos = a; pos < interiorFirst; ++pos) {
+        result[pos - a] = average(pos);
+      }
+      const auto upper = prefix.data() + (interiorFirst + windowRadius + 1 - lo);
+      const auto lower = prefix.data() + (interiorFirst - windowRadius - lo);
+      const auto interior = result.data() + (interiorFirst - a);
+      for(size_t i = 0; i < interiorLast - interiorFirst; ++i) {
+        interior[i] = static_cast<Value>((upper[i] - lower[i]) * scale);
+      }
+      for(auto pos = interiorLast; pos < b; ++pos) {
+        result[pos - a] = average(pos);
+      }
+
+      (void)std::copy(std::begin(result), std::end(result), dst + static_cast<std::ptrdiff_t>(a));
+
+      // keep the original samples the next chunk's left halo needs
+      const auto nextLo = (b > windowRadius ? b - windowRadius : 0);
+      window.resize(b - lo);
+      (void)window.erase(std::begin(window), std::begin(window) + static_cast<std::ptrdiff_t>(nextLo - lo));
+
+      a = b;
+    }
+  }
+
+  template<typename Source>
+  std::vector<double> copyRange(const Source& source, size_t first, size_t last)
+  {
+    const auto src = std::begin(source);
+    return std::vector<double>(src + static_cast<std::ptrdiff_t>(first), src + static_cast<std::ptrdiff_t>(last));
+  }
+
+  /// sequential reader of one channel of a sequence, keeping only its current group paged in
+  template<typename T>
+  struct ChannelReader
+  {
+    const Sequence<T>* seq;
+    uint8_t channel;
+    size_t group;
+    size_t frame; ///< within the current group
+    std::shared_ptr<const typename Sequence<T>::Samples> pinned;
+
+    T next()
+    {
+      if(!pinned) {
+        pinned = seq->pinGroup(group);
+      }
+      const auto frames = pinned->size() / seq->metadata.channelCount;
+      const auto value = (*pinned)[channel * frames + frame];
+      if(++frame == frames) {
+        frame = 0;
+        ++group;
+        pinned.reset();
+      }
+      return value;
+    }
+  };
+
+  /// moving average of each channel of a spilled sequence in a single pass, spilling the result as it is produced
+  /// so neither the input nor the result is held in memory
+  template<typename T>
+  Sequence<T> smoothSpilled(
+      const Sequence<T>& seq,
+      size_t windowRadius)
+  {
+    const auto channelCount = seq.metadata.channelCount;
+    const auto frameCount = seq.size() / channelCount;
+    const auto residentCount = seq.storage.size();
+
+    // running sum of the window [frame - windowRadius, frame + windowRadius] clipped to the sequence,
+    // with one reader entering and one leaving the window per channel
+    std::vector<double> sums(channelCount, 0.0);
+    std::vector<ChannelReader<T>> leads;
+    std::vector<ChannelReader<T>> lags;
+    for(uint8_t c = 0; c < channelCount; ++c) {
+      leads.push_back(ChannelReader<T>{&seq, c, 0, 0, {}});
+      lags.push_back(ChannelReader<T>{&seq, c, 0, 0, {}});
+      for(size_t i = 0; i < std::min(windowRadius, frameCount); ++i) {
+        sums[c] += static_cast<double>(leads[c].next());
+      }
+    }
+
+    Sequence<T> smoothed{seq.metadata, {}, {}};
+    for(size_t first = 0; first < frameCount;) {
+      const auto frames = std::min<size_t>(seq.metadata.sampleCount, frameCount - first);
+      typename Sequence<T>::Samples group(frames * channelCount);
+      for(uint8_t c = 0; c < channelCount; ++c) {
+        for(size_t i = 0; i < frames; ++i) {
+          const auto pos = first + i;
+          if(pos + windowRadius < frameCount) {
+            sums[c] += static_cast<double>(leads[c].next());
+          }
+          if(pos > windowRadius) {
+            sums[c] -= static_cast<double>(lags[c].next());
+          }
+          const auto windowFirst = (pos > windowRadius ? pos - windowRadius : 0);
+          const auto windowLast = std::min(frameCount, pos + windowRadius + 1);
+          group[c * frames + i] = static_cast<T>(sums[c] / static_cast<double>(windowLast - windowFirst));
+        }
+      }
+      smoothed.push(std::move(group));
+      if(smoothed.storage.size() > residentCount) {
+        smoothed.spill(residentCount);
+      }
+      first += frames;
+    }
+    return smoothed;
+  }
+} // namespace detail
+
+/// moving average over a window of 2 * windowRadius + 1 samples, shrunk at the borders,
+/// written to smoothed (of at least the same size); source and smoothed may be the same container
+/// @note  long inputs are split into ranges smoothed in parallel
+template<typename Source, typename Destination>
+void smooth(
+    const Source& source,
+    Destination& smoothed,
+    size_t windowRadius)
+{
+  const auto size = source.size();
+  if(size == 0) {
+    return;
+  }
+
+  const auto chunkSize = std::max(detail::smoothChunkSize, detail::smoothChunksPerWindow * (2 * windowRadius + 1));
+  const auto chunkCount = (size + chunkSize - 1) / chunkSize;
+  const auto threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), chunkCount));
+
+  // take all halos before any range gets overwritten
+  struct Range
+  {
+    size_t first;
+    size_t last;
+    std::vector<double> leftHalo;
+    std::vector<double> rightHalo;
+  };
+  std::vector<Range> ranges;
+  for(size_t t = 0; t < threadCount; ++t) {
+    const auto first = chunkCount * t / threadCount * chunkSize;
+    const auto last = std::min(size, chunkCount * (t + 1) / threadCount * chunkSize);
+    ranges.push_back(Range{
+      first,
+      last,
+      detail::copyRange(source, (first > windowRadius ? first - windowRadius : 0), first),
+      detail::copyRange(source, last, std::min(size, last + windowRadius))
+    });
+  }
+
+  std::vector<std::future<void>> workers;
+  for(size_t t = 1; t < threadCount; ++t) {
+    workers.push_back(std::async(std::launch::async, [&, t]() {
+      auto&& range = ranges[t];
+      detail::smoothRange(source, smoothed, windowRadius, chunkSize,
+                          range.first, range.last, std::move(range.leftHalo), range.rightHalo);
+    }));
+  }
+  auto&& range = ranges.front();
+  detail::smoothRange(source, smoothed, windowRadius, chunkSize,
+                      range.first, range.last, std::move(range.leftHalo), range.rightHalo);
+
+  for(auto&& worker : workers) {
+    worker.get();
+  }
+}
+
+/// moving average in place
 template<typename Container>
 Container smooth(
     Container container,
     size_t windowRadius)
 {
-  const auto windowSize = windowRadius * 2 + 1;
+  smooth(container, container, windowRadius);
+  return container;
+}
 
-  Container smoothed = container;
+/// moving average of each channel separately
+/// @note  a spilled sequence is smoothed in a single sequential pass, with the result spilled alike
+template<typename T>
+Sequence<T> smooth(
+    const Sequence<T>& seq,
+    size_t windowRadius)
+{
+  if(seq.spilled.count() > 0) {
+    return detail::smoothSpilled(seq, windowRadius);
+  }
 
-  if(windowSize < container.size()) {
-    struct Window
-    {
-      size_t front;
-      size_t mid;
-      size_t back;
-      size_t count;
-      float sum;
-    } window = {};
-
-    // preload
-    for(; window.back < windowRadius; ++window.back) {
-      window.sum += container[window.back];
-      ++window.count;
-    }
-    // front half window
-    for(; window.back < windowSize; ++window.mid, ++window.back) {
-      window.sum += container[window.back];
-      ++window.count;
-      smoothed[window.mid] = window.sum / window.count;
-    }
-    // whole window
-    for(; window.back < container.size(); ++window.front, ++window.mid, ++window.back) {
-      window.sum -= container[window.front];
-      window.sum += container[window.back];
-      smoothed[window.mid] = window.sum / window.count;
-    }
-    // back half window
-    for(; window.mid < container.size(); ++window.front, ++window.mid) {
-      window.sum -= container[window.front];
-      --window.count;
-      smoothed[window.mid] = window.sum / window.count;
-    }
-    // unload (omitted)
+  Sequence<T> smoothed = seq;
+  if(seq.metadata.channelCount == 1) {
+    smooth(smoothed, smoothed, windowRadius);
   } else {
-    assert(false); // TODO
+    for(uint8_t c = 0; c < seq.metadata.channelCount; ++c) {
+      auto channel = smoothed.channel(c);
+      smooth(channel, channel, windowRadius);
+    }
   }
-
   return smoothed;
 }
 
@@ -0,0 +1,162 @@
+#include "AudioBackend.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace audio {
+
+namespace {
+  // a rate the device does not support is converted by the devices' own resampling stage rather than by SDL
+  const int allowedAudioChange = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE;
+
+  const int pauseEnable = 1;
+  const int pauseDisable = 0;
+
+  // unsigned samples are centered; all other formats are silent at zero
+  const uint8_t unsignedSilence = 0x80;
+
+  bool isValid(SDL_AudioDeviceID deviceId)
+  {
+    return (deviceId >= 2); // see SDL_OpenAudioDevice()
+  }
+
+  void printDevices(int isCapture)
+  {
+    const int numAudioDevices = SDL_GetNumAudioDevices(isCapture);
+
+    std::cout << "Available audio " << (isCapture ? "capture" : "playback") << " devices:\n";
+    for(int i = 0; i < numAudioDevices; ++i) {
+      std::cout << SDL_GetAudioDeviceName(i, isCapture) << std::endl;
+    }
+  }
+} // namespace
+
+Backend::Opened SdlBackend::open(bool isCapture, const SDL_AudioSpec& spec)
+{
+  printDevices(isCapture);
+
+  SDL_AudioSpec have;
+  const auto deviceId = SDL_OpenAudioDevice(nullptr, isCapture, &spec, &have, allowedAudioChange);
+  if(!isValid(deviceId))
+    throw std::runtime_error(std::string("Failed to open audio: ") + SDL_GetError());
+
+  return Opened{deviceId, have};
+}
+
+void SdlBackend::close(DeviceId deviceId)
+{
+  SDL_CloseAudioDevice(deviceId);
+}
+
+void SdlBackend::pause(DeviceId deviceId, bool isPaused)
+{
+  SDL_PauseAudioDevice(deviceId, isPaused ? pauseEnable : pauseDisable);
+}
+
+void SdlBackend::delay(uint32_t msec)
+{
+  SDL_Delay(msec);
+}
+
+uint32_t SdlBackend::ticks()
+{
+  return SDL_GetTicks();
+}
+
+OfflineBackend::OfflineBackend(Reader input, Writer output, int sampleRate)
+  : input_(std::move(input))
+  , output_(std::move(output))
+  , sampleRate_(sampleRate)
+  , nextId_(1)
+  , nowMsec_(0.0)
+{
+}
+
+Backend::Opened OfflineBackend::open(bool isCapture, const SDL_AudioSpec& spec)
+{
+  const auto bufferSize = static_cast<size_t>(spec.samples) * spec.channels * SDL_AUDIO_BITSIZE(spec.format) / 8;
+  if(spec.freq <= 0 || bufferSize == 0 || !spec.callback) {
+    throw std::runtime_error("Failed to open audio: invalid offline device");
+  }
+
+  auto have = spec;
+  if(sampleRate_ > 0) {
+    have.freq = sampleRate_;
+  }
+
+  const auto periodMsec = 1000.0 * have.samples / have.freq;
+  const auto deviceId = nextId_++;
+  devices_[deviceId] = Device{have, isCapture, true, nowMsec_ + periodMsec, std::vector<uint8_t>(bufferSize)};
+  return Opened{deviceId, have};
+}
+
+void OfflineBackend::close(DeviceId deviceId)
+{
+  (void)devices_.erase(deviceId);
+}
+
+void OfflineBackend::pause(DeviceId deviceId, bool isPaused)
+{
+  auto it = devices_.find(deviceId);
+  if(it == std::end(devices_)) {
+    return;
+  }
+
+  auto&& device = it->second;
+  if(device.isPaused && !isPaused) {
+    // a resumed device delivers its first buffer one period later
+    device.dueMsec = nowMsec_ + 1000.0 * device.spec.samples / device.spec.freq;
+  }
+  device.isPaused = isPaused;
+}
+
+void OfflineBackend::delay(uint32_t msec)
+{
+  const auto endMsec = nowMsec_ + msec;
+
+  // run the callbacks in the order they are due
+  for(;;) {
+    auto next = std::end(devices_);
+    for(auto it = std::begin(devices_); it != std::end(devices_); ++it) {
+      if(!it->second.isPaused && (next == std::end(devices_) || it->second.dueMsec < next->second.dueMsec)) {
+        next = it;
+      }
+    }
+    if(next == std::end(devices_) || next->second.dueMsec > endMsec) {
+      break;
+    }
+
+    auto&& device = next->second;
+    nowMsec_ = device.dueMsec;
+    device.dueMsec += 1000.0 * device.spec.samples / device.spec.freq;
+
+    auto stream = device.buffer.data();
+    const auto len = device.buffer.size();
+    if(device.isCapture) {
+      const auto provided = (input_ ? std::min(input_(stream, len), len) : 0);
+      std::fill(stream + provided, stream + len, (device.spec.format == AUDIO_U8 ? unsignedSilence : 0));
+      device.spec.callback(device.spec.userdata, stream, static_cast<int>(len));
+    } else {
+      device.spec.callback(device.spec.userdata, stream, static_cast<int>(len));
+      if(output_) {
+        output_(stream, len);
+      }
+    }
+  }
+
+  nowMsec_ = endMsec;
+}
+
+uint32_t OfflineBackend::ticks()
+{
+  return static_cast<uint32_t>(nowMsec_);
+}
+
+std::shared_ptr<Backend> defaultBackend()
+{
+  return std::make_shared<SdlBackend>();
+}
+
+} // namespace audio
@@ -0,0 +1,125 @@
+#ifndef AUDIO_BACKEND_H
+#define AUDIO_BACKEND_H
+
+#include "AudioSource.h"
+#include "SdlGuard.h"
+
+#define SDL_MAIN_HANDLED
+#include "SDL2/SDL.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace audio {
+
+/// audio device layer the capture and playback devices run on
+struct Backend
+{
+  using DeviceId = uint32_t;
+
+  struct Opened
+  {
+    DeviceId id;
+    SDL_AudioSpec spec; ///< as obtained; only the rate may differ from the one requested
+  };
+
+  virtual ~Backend() = default;
+
+  /// open a paused device driving spec.callback with spec.userdata
+  /// @return  device running at its own rate if it does not support the requested one
+  /// @throw  std::runtime_error if the device cannot be opened
+  virtual Opened open(bool isCapture, const SDL_AudioSpec& spec) = 0;
+  virtual void close(DeviceId deviceId) = 0;
+  virtual void pause(DeviceId deviceId, bool isPaused) = 0;
+
+  /// wait while the devices keep running
+  virtual void delay(uint32_t msec) = 0;
+
+  /// time since an arbitrary start [ms]
+  virtual uint32_t ticks() = 0;
+};
+
+/// sound card devices opened through SDL, called back in real time from SDL's audio threads
+struct SdlBackend : Backend
+{
+  Opened open(bool isCapture, const SDL_AudioSpec& spec) override;
+  void close(DeviceId deviceId) override;
+  void pause(DeviceId deviceId, bool isPaused) override;
+  void delay(uint32_t msec) override;
+  uint32_t ticks() override;
+
+private:
+  SdlGuard guard_;
+};
+
+/// headless devices on a virtual clock; delay() runs the callbacks of all unpaused devices
+/// due within the delay synchronously, i.e. as fast as the CPU allows
+/// @note  devices only progress while a device (or the caller) waits via delay()
+struct OfflineBackend : Backend
+{
+  /// fill a capture buffer
+  /// @return  number of bytes provided; the rest of the buffer is silence
+  using Reader = std::function<size_t(uint8_t* stream, size_t len)>;
+
+  /// consume a played buffer
+  using Writer = std::function<void(const uint8_t* stream, size_t len)>;
+
+  /// @param input  capture source; silence if empty
+  /// @param output  playback sink; discarded if empty
+  /// @param sampleRate  rate all devices run at, like a sound card fixed to it; 0 for the requested rates
+  OfflineBackend(Reader input = Reader(), Writer output = Writer(), int sampleRate = 0);
+
+  Opened open(bool isCapture, const SDL_AudioSpec& spec) override;
+  void close(DeviceId deviceId) override;
+  void pause(DeviceId deviceId, bool isPaused) override;
+  void delay(uint32_t msec) override;
+  uint32_t ticks() override;
+
+private:
+  struct Device
+  {
+    SDL_AudioSpec spec;
+    bool isCapture;
+    bool isPaused;
+    double dueMsec; ///< virtual time of the next callback
+    std::vector<uint8_t> buffer;
+  };
+
+  Reader input_;
+  Writer output_;
+  int sampleRate_;
+  std::map<DeviceId, Device> devices_;
+  DeviceId nextId_;
+  double nowMsec_;
+};
+
+/// backend of devices not given one explicitly
+std::shared_ptr<Backend> defaultBackend();
+
+/// offline capture input from a source of samples in the device format
+template<typename T>
+OfflineBackend::Reader sourceReader(std::shared_ptr<Source<T>> source)
+{
+  return [source](uint8_t* stream, size_t len) -> size_t {
+    return source->read(reinterpret_cast<T*>(stream), len / sizeof(T)) * sizeof(T);
+  };
+}
+
+/// offline playback output appended to interleaved samples in the device format
+/// @note  the samples have to outlive the backend
+template<typename T>
+OfflineBackend::Writer vectorWriter(std::vector<T>& samples)
+{
+  return [&samples](const uint8_t* stream, size_t len) {
+    const auto first = reinterpret_cast<const T*>(stream);
+    samples.insert(std::end(samples), first, first + len / sizeof(T));
+  };
+}
+
+} // namespace audio
+
+#endif // AUDIO_BACKEND_H
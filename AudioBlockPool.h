@@ -0,0 +1,66 @@
+#ifndef AUDIO_BLOCK_POOL_H
+#define AUDIO_BLOCK_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/// behaviour of a capture once its preallocated blocks are exhausted
+enum class OverflowPolicy
+{
+  Grow, ///< replenish blocks from the (non real-time) recording thread
+  Drop, ///< discard further capture groups
+  Signal ///< discard further capture groups and report the overflow as error
+};
+
+/// fixed-capacity ring of preallocated sample blocks
+/// handing capture groups from the real-time thread to a consumer thread
+/// without allocating on the real-time path
+template<typename T>
+struct BlockPool
+{
+  using Block = std::vector<T>;
+
+  BlockPool();
+  BlockPool(size_t blockSize, size_t blockCount);
+  BlockPool(const BlockPool&) = delete;
+  BlockPool(BlockPool&&) = delete;
+
+  /// (re-)allocate all blocks; not safe while the producer is running
+  void reset(size_t blockSize, size_t blockCount);
+
+  /// copy interleaved samples into the next free block as planar channels (real-time safe)
+  /// @return  false if no free block was available and the samples were dropped
+  bool write(const T* first, const T* last, size_t channelCount = 1);
+
+  /// move all filled blocks to the consumer
+  /// @return  number of blocks harvested
+  template<typename Container>
+  size_t harvest(Container& blocks);
+
+  /// allocate fresh blocks for all harvested slots (consumer thread only)
+  void replenish();
+
+  /// number of free blocks still available to the producer
+  size_t available() const;
+
+  /// number of write() calls that found the pool exhausted
+  size_t dropped() const;
+
+private:
+  std::vector<Block> slots_; ///< ring of blocks, never reallocated while in use
+  size_t blockSize_;
+  size_t readIndex_; ///< consumer position: next slot to harvest
+  std::atomic<size_t> writeIndex_; ///< producer position: next slot to fill
+  std::atomic<size_t> freeIndex_; ///< end of the allocated blocks available to the producer
+  std::atomic<size_t> dropped_;
+};
+
+} // namespace audio
+
+#include "AudioBlockPool_impl.h"
+
+#endif // AUDIO_BLOCK_POOL_H
@@ -0,0 +1,107 @@
+#ifndef AUDIO_BLOCK_POOL_IMPL_H
+#define AUDIO_BLOCK_POOL_IMPL_H
+
+#ifndef AUDIO_BLOCK_POOL_H
+#error "Include via AudioBlockPool.h"
+#endif // AUDIO_BLOCK_POOL_H
+
+#include "AudioChannels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace audio {
+
+template<typename T>
+BlockPool<T>::BlockPool()
+  : blockSize_(0)
+  , readIndex_(0)
+  , writeIndex_(0)
+  , freeIndex_(0)
+  , dropped_(0)
+{}
+
+template<typename T>
+BlockPool<T>::BlockPool(size_t blockSize, size_t blockCount)
+  : BlockPool()
+{
+  reset(blockSize, blockCount);
+}
+
+template<typename T>
+void BlockPool<T>::reset(size_t blockSize, size_t blockCount)
+{
+  slots_.clear();
+  slots_.reserve(blockCount);
+  for(size_t i = 0; i < blockCount; ++i) {
+    slots_.emplace_back(blockSize);
+  }
+
+  blockSize_ = blockSize;
+  readIndex_ = 0;
+  writeIndex_.store(0, std::memory_order_relaxed);
+  freeIndex_.store(blockCount, std::memory_order_relaxed);
+  dropped_.store(0, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool BlockPool<T>::write(const T* first, const T* last, size_t channelCount)
+{
+  const auto write = writeIndex_.load(std::memory_order_relaxed);
+  if(write == freeIndex_.load(std::memory_order_acquire)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto&& block = slots_[write % slots_.size()];
+
+  // shrinking within the preallocated capacity does not allocate
+  const auto count = std::min(static_cast<size_t>(std::distance(first, last)), blockSize_);
+  const auto frames = count / channelCount;
+  block.resize(frames * channelCount);
+  deinterleave(first, frames, channelCount, block.data(), frames);
+
+  writeIndex_.store(write + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+template<typename Container>
+size_t BlockPool<T>::harvest(Container& blocks)
+{
+  const auto write = writeIndex_.load(std::memory_order_acquire);
+  const auto count = write - readIndex_;
+  for(; readIndex_ != write; ++readIndex_) {
+    blocks.push_back(std::move(slots_[readIndex_ % slots_.size()]));
+  }
+  return count;
+}
+
+template<typename T>
+void BlockPool<T>::replenish()
+{
+  // harvested slots were moved from; refill up to one full ring ahead of the consumer
+  const auto end = readIndex_ + slots_.size();
+  auto free = freeIndex_.load(std::memory_order_relaxed);
+  for(; free != end; ++free) {
+    slots_[free % slots_.size()] = Block(blockSize_);
+  }
+  freeIndex_.store(free, std::memory_order_release);
+}
+
+template<typename T>
+size_t BlockPool<T>::available() const
+{
+  return freeIndex_.load(std::memory_order_acquire) - writeIndex_.load(std::memory_order_acquire);
+}
+
+template<typename T>
+size_t BlockPool<T>::dropped() const
+{
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+} // namespace audio
+
+#endif // AUDIO_BLOCK_POOL_IMPL_H
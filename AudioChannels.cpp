@@ -0,0 +1,91 @@
+#include "AudioChannels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_CHANNELS_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_CHANNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  const size_t stereo = 2;
+} // namespace
+
+void deinterleave(const float* src, size_t frameCount, size_t channelCount, float* dst, size_t planeStride)
+{
+  if(channelCount == 1) {
+    (void)std::copy(src, src + frameCount, dst);
+    return;
+  }
+  if(channelCount != stereo) {
+    deinterleave<float>(src, frameCount, channelCount, dst, planeStride);
+    return;
+  }
+
+  auto left = dst;
+  auto right = dst + planeStride;
+
+  size_t f = 0;
+#if defined(AUDIO_CHANNELS_SSE2)
+  for(; f + 4 <= frameCount; f += 4) {
+    const auto a = _mm_loadu_ps(src + 2 * f); // L0 R0 L1 R1
+    const auto b = _mm_loadu_ps(src + 2 * f + 4); // L2 R2 L3 R3
+    _mm_storeu_ps(left + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + f, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+#endif
+#if defined(AUDIO_CHANNELS_NEON)
+  for(; f + 4 <= frameCount; f += 4) {
+    const auto frames = vld2q_f32(src + 2 * f);
+    vst1q_f32(left + f, frames.val[0]);
+    vst1q_f32(right + f, frames.val[1]);
+  }
+#endif
+  for(; f < frameCount; ++f) {
+    left[f] = src[2 * f];
+    right[f] = src[2 * f + 1];
+  }
+}
+
+void interleave(const float* src, size_t planeStride, size_t frameCount, size_t channelCount, float* dst)
+{
+  if(channelCount == 1) {
+    (void)std::copy(src, src + frameCount, dst);
+    return;
+  }
+  if(channelCount != stereo) {
+    interleave<float>(src, planeStride, frameCount, channelCount, dst);
+    return;
+  }
+
+  auto left = src;
+  auto right = src + planeStride;
+
+  size_t f = 0;
+#if defined(AUDIO_CHANNELS_SSE2)
+  for(; f + 4 <= frameCount; f += 4) {
+    const auto l = _mm_loadu_ps(left + f);
+    const auto r = _mm_loadu_ps(right + f);
+    _mm_storeu_ps(dst + 2 * f, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(dst + 2 * f + 4, _mm_unpackhi_ps(l, r));
+  }
+#endif
+#if defined(AUDIO_CHANNELS_NEON)
+  for(; f + 4 <= frameCount; f += 4) {
+    float32x4x2_t frames;
+    frames.val[0] = vld1q_f32(left + f);
+    frames.val[1] = vld1q_f32(right + f);
+    vst2q_f32(dst + 2 * f, frames);
+  }
+#endif
+  for(; f < frameCount; ++f) {
+    dst[2 * f] = left[f];
+    dst[2 * f + 1] = right[f];
+  }
+}
+
+} // namespace audio
@@ -0,0 +1,41 @@
+#ifndef AUDIO_CHANNELS_H
+#define AUDIO_CHANNELS_H
+
+#include <algorithm>
+#include <cstddef>
+
+namespace audio {
+
+/// split interleaved frames into one contiguous plane per channel,
+/// channel c starting at dst + c * planeStride
+/// @note  stereo float uses SSE2/NEON as enabled for the build
+template<typename T>
+void deinterleave(const T* src, size_t frameCount, size_t channelCount, T* dst, size_t planeStride)
+{
+  for(size_t c = 0; c < channelCount; ++c) {
+    auto plane = dst + c * planeStride;
+    for(size_t f = 0; f < frameCount; ++f) {
+      plane[f] = src[f * channelCount + c];
+    }
+  }
+}
+void deinterleave(const float* src, size_t frameCount, size_t channelCount, float* dst, size_t planeStride);
+
+/// merge one contiguous plane per channel, channel c starting at src + c * planeStride,
+/// into interleaved frames
+/// @note  stereo float uses SSE2/NEON as enabled for the build
+template<typename T>
+void interleave(const T* src, size_t planeStride, size_t frameCount, size_t channelCount, T* dst)
+{
+  for(size_t c = 0; c < channelCount; ++c) {
+    auto plane = src + c * planeStride;
+    for(size_t f = 0; f < frameCount; ++f) {
+      dst[f * channelCount + c] = plane[f];
+    }
+  }
+}
+void interleave(const float* src, size_t planeStride, size_t frameCount, size_t channelCount, float* dst);
+
+} // namespace audio
+
+#endif // AUDIO_CHANNELS_H
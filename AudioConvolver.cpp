@@ -0,0 +1,169 @@
+#include "AudioConvolver.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_CONVOLVER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_CONVOLVER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  /// acc += x * h for count complex values
+  void multiplyAdd(const std::complex<float>* x, const std::complex<float>* h, size_t count, std::complex<float>* acc)
+  {
+    // complex values are pairs of floats
+    const auto xf = reinterpret_cast<const float*>(x);
+    const auto hf = reinterpret_cast<const float*>(h);
+    const auto accf = reinterpret_cast<float*>(acc);
+
+    size_t i = 0;
+#if defined(AUDIO_CONVOLVER_SSE2)
+    {
+      // two complex values per register: (re0, im0, re1, im1)
+      const auto sign = _mm_set_ps(1.f, -1.f, 1.f, -1.f);
+      for(; i + 2 <= count; i += 2) {
+        const auto a = _mm_loadu_ps(xf + 2 * i);
+        const auto b = _mm_loadu_ps(hf + 2 * i);
+        const auto bRe = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+        const auto bIm = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+        const auto aSwapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+        const auto product = _mm_add_ps(_mm_mul_ps(a, bRe), _mm_mul_ps(_mm_mul_ps(aSwapped, bIm), sign));
+        _mm_storeu_ps(accf + 2 * i, _mm_add_ps(_mm_loadu_ps(accf + 2 * i), product));
+      }
+    }
+#endif
+#if defined(AUDIO_CONVOLVER_NEON)
+    {
+      // four complex values split into real and imaginary parts
+      for(; i + 4 <= count; i += 4) {
+        const auto a = vld2q_f32(xf + 2 * i);
+        const auto b = vld2q_f32(hf + 2 * i);
+        auto sum = vld2q_f32(accf + 2 * i);
+        sum.val[0] = vmlsq_f32(vmlaq_f32(sum.val[0], a.val[0], b.val[0]), a.val[1], b.val[1]);
+        sum.val[1] = vmlaq_f32(vmlaq_f32(sum.val[1], a.val[0], b.val[1]), a.val[1], b.val[0]);
+        vst2q_f32(accf + 2 * i, sum);
+      }
+    }
+#endif
+    for(; i < count; ++i) {
+      const auto re = xf[2 * i] * hf[2 * i] - xf[2 * i + 1] * hf[2 * i + 1];
+      const auto im = xf[2 * i] * hf[2 * i + 1] + xf[2 * i + 1] * hf[2 * i];
+      accf[2 * i] += re;
+      accf[2 * i + 1] += im;
+    }
+  }
+} // namespace
+
+Convolver::Convolver(const Metadata& metadata, const std::vector<float>& impulseResponse)
+  : metadata_(metadata)
+  , blockSize_(metadata.sampleCount)
+  , fftSize_(2 * blockSize_)
+  , partitionCount_(std::max<size_t>(1, (impulseResponse.size() + blockSize_ - 1) / std::max<size_t>(1, blockSize_)))
+  , laneCount_((metadata.channelCount + 1u) / 2)
+  , forward_(fftSize_, false)
+  , inverse_(fftSize_, true)
+  , responseSpectra_(partitionCount_ * fftSize_)
+  , inputs_(laneCount_ * fftSize_)
+  , delayLine_(laneCount_ * partitionCount_ * fftSize_)
+  , delayLineHead_(0)
+  , accumulator_(fftSize_)
+  , transformed_(fftSize_)
+  , inputBlock_(metadata.groupSize())
+  , outputBlock_(metadata.groupSize())
+  , blockPosition_(0)
+{
+  if(blockSize_ == 0 || metadata.channelCount == 0) {
+    throw std::runtime_error("Invalid convolver settings");
+  }
+
+  // each partition is zero-padded to the transform size; the inverse transform's scale is folded in
+  const auto scale = 1.f / static_cast<float>(fftSize_);
+  std::vector<Complex> padded(fftSize_);
+  for(size_t p = 0; p < partitionCount_; ++p) {
+    std::fill(std::begin(padded), std::end(padded), Complex());
+    const auto first = std::min(p * blockSize_, impulseResponse.size());
+    const auto last = std::min(first + blockSize_, impulseResponse.size());
+    for(auto i = first; i < last; ++i) {
+      padded[i - first] = Complex(impulseResponse[i] * scale);
+    }
+    forward_.transform(padded.data(), responseSpectra_.data() + p * fftSize_);
+  }
+}
+
+void Convolver::process(float* samples, size_t count)
+{
+  const size_t channelCount = metadata_.channelCount;
+  auto frames = count / channelCount;
+  while(frames > 0) {
+    // input replaces the output of the same position one block earlier
+    const auto n = std::min(frames, blockSize_ - blockPosition_);
+    const auto offset = blockPosition_ * channelCount;
+    (void)std::copy(samples, samples + n * channelCount, inputBlock_.data() + offset);
+    (void)std::copy(outputBlock_.data() + offset, outputBlock_.data() + offset + n * channelCount, samples);
+
+    samples += n * channelCount;
+    frames -= n;
+    blockPosition_ += n;
+    if(blockPosition_ == blockSize_) {
+      convolveBlock();
+      blockPosition_ = 0;
+    }
+  }
+}
+
+void Convolver::reset()
+{
+  std::fill(std::begin(inputs_), std::end(inputs_), Complex());
+  std::fill(std::begin(delayLine_), std::end(delayLine_), Complex());
+  std::fill(std::begin(inputBlock_), std::end(inputBlock_), 0.f);
+  std::fill(std::begin(outputBlock_), std::end(outputBlock_), 0.f);
+  delayLineHead_ = 0;
+  blockPosition_ = 0;
+}
+
+void Convolver::convolveBlock()
+{
+  const size_t channelCount = metadata_.channelCount;
+  delayLineHead_ = (delayLineHead_ + 1) % partitionCount_;
+
+  for(size_t lane = 0; lane < laneCount_; ++lane) {
+    // overlap-save: the previous block followed by the new one, channel pairs as real and imaginary parts
+    const auto input = inputs_.data() + lane * fftSize_;
+    (void)std::copy(input + blockSize_, input + fftSize_, input);
+    const auto re = 2 * lane;
+    const auto im = re + 1;
+    for(size_t f = 0; f < blockSize_; ++f) {
+      const auto frame = inputBlock_.data() + f * channelCount;
+      input[blockSize_ + f] = Complex(frame[re], im < channelCount ? frame[im] : 0.f);
+    }
+
+    const auto delayLine = delayLine_.data() + lane * partitionCount_ * fftSize_;
+    forward_.transform(input, delayLine + delayLineHead_ * fftSize_);
+
+    // the spectrum of the block p blocks ago meets partition p of the response
+    std::fill(std::begin(accumulator_), std::end(accumulator_), Complex());
+    for(size_t p = 0; p < partitionCount_; ++p) {
+      const auto slot = (delayLineHead_ + partitionCount_ - p) % partitionCount_;
+      multiplyAdd(delayLine + slot * fftSize_, responseSpectra_.data() + p * fftSize_, fftSize_, accumulator_.data());
+    }
+    inverse_.transform(accumulator_.data(), transformed_.data());
+
+    // the second half is free of circular wrap-around
+    for(size_t f = 0; f < blockSize_; ++f) {
+      const auto frame = outputBlock_.data() + f * channelCount;
+      frame[re] = transformed_[blockSize_ + f].real();
+      if(im < channelCount) {
+        frame[im] = transformed_[blockSize_ + f].imag();
+      }
+    }
+  }
+}
+
+} // namespace audio
@@ -0,0 +1,59 @@
+#ifndef AUDIO_CONVOLVER_H
+#define AUDIO_CONVOLVER_H
+
+#include "AudioSequence.h"
+
+#include "kissfft/kissfft.hh"
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace audio {
+
+/// convolution of a live interleaved stream with a fixed impulse response of any length,
+/// e.g. a room response for reverb, by uniformly partitioned overlap-save FFT convolution:
+/// the response is cut into blocks of metadata.sampleCount frames whose spectra are computed once,
+/// each input block is transformed once and multiplied with all of them via a frequency-domain delay line
+/// @note  pairs of channels share one complex transform; the spectral products use SSE2/NEON as enabled for the build
+struct Convolver
+{
+  using Complex = std::complex<float>;
+
+  /// @param impulseResponse  filter applied to every channel; include a unit impulse at 0 to keep the dry signal
+  Convolver(const Metadata& metadata, const std::vector<float>& impulseResponse);
+
+  /// convolve interleaved samples in place; the output is delayed by exactly one block of metadata.sampleCount frames
+  /// @note  does not allocate, so it may run in a device callback (e.g. as Duplex::Processor)
+  void process(float* samples, size_t count);
+  void operator()(float* samples, size_t count) { process(samples, count); }
+
+  /// restart from silence
+  void reset();
+
+private:
+  /// convolve the completed input block into the next output block
+  void convolveBlock();
+
+private:
+  Metadata metadata_;
+  size_t blockSize_; // [frames]
+  size_t fftSize_; ///< two blocks: the previous input block is the overlap
+  size_t partitionCount_;
+  size_t laneCount_; ///< complex transforms per block, one per pair of channels
+  kissfft<float> forward_;
+  kissfft<float> inverse_;
+  std::vector<Complex> responseSpectra_; ///< partitionCount spectra of fftSize bins, scaled for the inverse transform
+  std::vector<Complex> inputs_; ///< last two input blocks per lane
+  std::vector<Complex> delayLine_; ///< partitionCount most recent input spectra per lane, a ring
+  size_t delayLineHead_; ///< partition slot of the most recent input spectrum
+  std::vector<Complex> accumulator_; ///< output spectrum of one lane
+  std::vector<Complex> transformed_; ///< output block of one lane
+  std::vector<float> inputBlock_; ///< interleaved input collected for the next block
+  std::vector<float> outputBlock_; ///< interleaved output of the previous block
+  size_t blockPosition_; // [frames]
+};
+
+} // namespace audio
+
+#endif // AUDIO_CONVOLVER_H
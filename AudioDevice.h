@@ -1,21 +1,66 @@
 #ifndef AUDIO_DEVICE_H
 #define AUDIO_DEVICE_H
 
+#include "AudioBackend.h"
+#include "AudioBlockPool.h"
+#include "AudioFormat.h"
+#include "AudioResampler.h"
+#include "AudioRingBuffer.h"
 #include "AudioSequence.h"
-#include "SdlGuard.h"
-
-#define SDL_MAIN_HANDLED
-#include "SDL2/SDL.h"
+#include "AudioSource.h"
+#include "AudioView.h"
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace audio {
 
+/// resampling stage in the callback of a device not running at the requested rate;
+/// samples at the requested rate are exchanged in blocks of one capture group
+/// @note  preallocated for the given block and device buffer sizes, so it does not allocate
+template<typename T>
+struct DeviceResampler
+{
+  /// @param frameCount  frames per block at the requested rate
+  /// @param deviceFrameCount  frames per device buffer
+  DeviceResampler(int inputRate, int outputRate, uint8_t channelCount, size_t frameCount, size_t deviceFrameCount);
+
+  /// resample captured samples, handing on each completed block via push(const T* samples, size_t count)
+  template<typename Push>
+  void push(const T* samples, size_t count, Push push);
+
+  /// fill samples for playback, resampling blocks requested via pull(T* samples, size_t count) as needed
+  template<typename Pull>
+  void pull(T* samples, size_t count, Pull pull);
+
+private:
+  /// append the resampled frames to those not handed on yet
+  void process(const T* samples, size_t frameCount);
+
+private:
+  size_t channelCount_;
+  size_t frameCount_;
+  Resampler resampler_;
+  std::vector<T> block_; ///< one block pulled at the requested rate
+  std::vector<float> input_;
+  std::vector<float> resampled_;
+  std::vector<T> output_; ///< resampled samples not handed on yet
+  size_t outputFirst_; // [samples]
+  size_t outputLast_; // [samples]
+};
+
 template<typename T>
 struct DeviceCapture
 {
-  DeviceCapture(const Metadata& metadata = Metadata());
+  DeviceCapture(const Metadata& metadata = Metadata(),
+                OverflowPolicy policy = OverflowPolicy::Grow,
+                std::shared_ptr<Backend> backend = defaultBackend());
   DeviceCapture(const DeviceCapture&) = delete;
   DeviceCapture(DeviceCapture&&) = delete;
   ~DeviceCapture();
@@ -23,34 +68,118 @@ struct DeviceCapture
   Sequence<T> record(std::chrono::milliseconds length);
   Sequence<T> record(uint32_t lengthMsec);
 
+  /// record with bounded memory: capture groups beyond about residentLength of audio are spilled
+  /// to a temporary file in large sequential writes and paged back in when the sequence is accessed
+  /// @note  the capture pool is refilled during the recording regardless of the overflow policy
+  Sequence<T> record(std::chrono::milliseconds length, std::chrono::milliseconds residentLength);
+
+  /// start continuous capture into a ring buffer holding the given length of audio
+  void start(std::chrono::milliseconds bufferLength);
+  void start(uint32_t bufferLengthMsec = 1000);
+
+  /// stop continuous capture; samples already buffered remain readable
+  void stop();
+
+  /// read captured samples, blocking until count samples arrived or capture is stopped
+  /// @return  number of samples read
+  size_t read(T* samples, size_t count);
+
+  /// read captured samples available right now without blocking
+  /// @return  number of samples read
+  size_t tryRead(T* samples, size_t count);
+
+  /// number of captured samples lost because the reader did not keep up
+  size_t overruns() const;
+
 private:
+  /// @param residentCount  number of capture groups kept in memory
+  Sequence<T> record(uint32_t lengthMsec, size_t residentCount);
+
   static void deviceCallback(void* userdata, uint8_t* stream, int len);
   void deviceCallback(uint8_t* stream, int len);
 
+  /// hand on samples at the requested rate to continuous capture or the recording
+  void capture(const T* first, const T* last);
+
 private:
-  SdlGuard guard_;
+  std::shared_ptr<Backend> backend_;
   Sequence<T> seq_;
-  SDL_AudioDeviceID deviceId_;
+  OverflowPolicy policy_;
+  BlockPool<T> pool_; ///< preallocated capture groups filled by the device callback in record()
+  RingBuffer<T> ring_; ///< continuous capture between start() and stop()
+  std::atomic<bool> isStreaming_;
+  std::atomic<size_t> overruns_;
+  Backend::DeviceId deviceId_;
+  std::unique_ptr<DeviceResampler<T>> resampler_; ///< if the device runs at another rate
 };
 
 template<typename T>
 struct DevicePlayback
 {
-  DevicePlayback(const Metadata& metadata = Metadata());
+  DevicePlayback(const Metadata& metadata = Metadata(), std::shared_ptr<Backend> backend = defaultBackend());
   DevicePlayback(const DevicePlayback&) = delete;
   DevicePlayback(DevicePlayback&&) = delete;
   ~DevicePlayback();
 
-  void play(Sequence<T> seq);
+  /// play back and block until done; the sequence is only borrowed, not copied
+  void play(const Sequence<T>& seq);
+
+  /// queue for playback directly after all previously queued sequences
+  /// @return  future that becomes ready once the sequence was played back
+  std::future<void> enqueue(Sequence<T> seq);
+
+  /// queue a shared read-only sequence for playback without copying it;
+  /// the same sequence may be queued any number of times
+  /// @return  future that becomes ready once the sequence was played back
+  std::future<void> enqueue(std::shared_ptr<const Sequence<T>> seq);
+
+  /// queue a lazy view for playback; samples are only evaluated by the device callback
+  /// @note  the viewed sequence has to outlive the playback
+  /// @return  future that becomes ready once the view was played back
+  template<typename Mapping>
+  std::future<void> enqueue(View<Mapping> view);
+
+  /// queue a source to be pulled from by the device callback until exhausted,
+  /// e.g. a generator rendering a long or endless signal on demand
+  /// @return  future that becomes ready once the source was played back
+  std::future<void> enqueue(std::unique_ptr<Source<T>> source);
+
+  /// block until queued playback is done, letting the backend run the device meanwhile
+  /// @note  futures become ready on their own with a real device; backends that only progress
+  ///        while waited on (OfflineBackend) need to be waited on here instead
+  void wait(const std::future<void>& done);
 
 private:
+  struct Entry
+  {
+    std::unique_ptr<Source<T>> source;
+    std::promise<void> done;
+  };
+
   static void deviceCallback(void* userdata, uint8_t* stream, int len);
   void deviceCallback(uint8_t* stream, int len);
 
+  /// fill samples at the requested rate from the queued entries
+  void render(T* samples, size_t count);
+
+  /// fulfil the promises of and deallocate the entries the device callback is done with
+  /// @note  called by the reclaiming thread and by wait(), so the latter does not have to wait for the former
+  void reclaim();
+
+  /// reclaim periodically until closing
+  void run();
+
 private:
-  SdlGuard guard_;
-  SDL_AudioDeviceID deviceId_;
-  Sequence<T> seq_;
+  std::shared_ptr<Backend> backend_;
+  Backend::DeviceId deviceId_;
+  std::unique_ptr<DeviceResampler<T>> resampler_; ///< if the device runs at another rate
+  RingBuffer<Entry*> pending_; ///< queued entries handed to the device callback
+  RingBuffer<Entry*> finished_; ///< played entries handed back for deallocation
+  Entry* current_; ///< entry being played back by the device callback
+  std::atomic<size_t> queuedCount_; ///< entries not yet reclaimed, bounding finished_
+  std::mutex reclaimMutex_; ///< finished_ has a single reader at a time
+  std::atomic<bool> isClosing_;
+  std::thread thread_; ///< reclaims played entries off the device callback
 };
 
 } // namespace audio
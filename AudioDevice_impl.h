@@ -5,8 +5,13 @@
 #error "Include via AudioDevice.h"
 #endif // AUDIO_DEVICE_H
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace audio {
 
@@ -15,10 +20,12 @@ namespace detail {
   static const uint16_t audioSpecPadding = 0;
   static const uint32_t audioSpecSize = 0;
 
-  static const int allowedAudioChange = 0;
+  static const uint32_t poolServiceIntervalMsec = 100;
+  static const size_t poolSlackBlockCount = 2;
 
-  static const int pauseEnable = 1;
-  static const int pauseDisable = 0;
+  static const size_t playbackQueueCapacity = 64;
+  static const uint32_t playbackWaitIntervalMsec = 10;
+  static const uint32_t playbackReclaimIntervalMsec = 10;
 
   template<typename T>
   struct FormatLookUp
@@ -29,27 +36,116 @@ namespace detail {
   struct FormatLookUp<float>
   {
     static const SDL_AudioFormat format = AUDIO_F32SYS;
+    static float silence() { return 0.f; }
   };
 
-  inline bool isValid(SDL_AudioDeviceID deviceId)
+  template<>
+  struct FormatLookUp<int16_t>
   {
-    return (deviceId >= 2); // see SDL_OpenAudioDevice()
-  }
+    static const SDL_AudioFormat format = AUDIO_S16SYS;
+    static int16_t silence() { return 0; }
+  };
 
-  inline void printDevices(int isCapture)
+  template<>
+  struct FormatLookUp<int32_t>
   {
-    const int numAudioDevices = SDL_GetNumAudioDevices(isCapture);
+    static const SDL_AudioFormat format = AUDIO_S32SYS;
+    static int32_t silence() { return 0; }
+  };
+
+  template<>
+  struct FormatLookUp<uint8_t>
+  {
+    static const SDL_AudioFormat format = AUDIO_U8;
+    static uint8_t silence() { return 128; }
+  };
 
-    std::cout << "Available audio " << (isCapture ? "capture" : "playback") << " devices:\n";
-    for(int i = 0; i < numAudioDevices; ++i) {
-      std::cout << SDL_GetAudioDeviceName(i, isCapture) << std::endl;
+  /// resampling stage between the requested rate and the rate the device was opened at, if they differ
+  template<typename T>
+  std::unique_ptr<DeviceResampler<T>> deviceResampler(bool isCapture, const Metadata& metadata, const SDL_AudioSpec& have)
+  {
+    if(have.freq == metadata.sampleRate) {
+      return nullptr;
     }
+    const auto inputRate = (isCapture ? have.freq : metadata.sampleRate);
+    const auto outputRate = (isCapture ? metadata.sampleRate : have.freq);
+    return std::unique_ptr<DeviceResampler<T>>(
+          new DeviceResampler<T>(inputRate, outputRate, metadata.channelCount, metadata.sampleCount, have.samples));
   }
 } // namespace detail
 
 template<typename T>
-DeviceCapture<T>::DeviceCapture(const Metadata& metadata)
-  : seq_{metadata, {}}
+DeviceResampler<T>::DeviceResampler(int inputRate, int outputRate, uint8_t channelCount, size_t frameCount, size_t deviceFrameCount)
+  : channelCount_(channelCount)
+  , frameCount_(frameCount)
+  , resampler_(inputRate, outputRate, channelCount)
+  , block_(frameCount * channelCount)
+  , input_(std::max(frameCount, deviceFrameCount) * channelCount)
+  , resampled_(resampler_.maxOutputFrames(std::max(frameCount, deviceFrameCount)) * channelCount)
+  , output_(block_.size() + resampled_.size())
+  , outputFirst_(0)
+  , outputLast_(0)
+{
+  resampler_.reserve(std::max(frameCount, deviceFrameCount));
+}
+
+template<typename T>
+template<typename Push>
+void DeviceResampler<T>::push(const T* samples, size_t count, Push push)
+{
+  const auto frameCount = count / channelCount_;
+  const auto blockSize = block_.size();
+  for(size_t done = 0; done < frameCount;) {
+    const auto n = std::min(frameCount - done, input_.size() / channelCount_);
+    process(samples + done * channelCount_, n);
+    for(; outputLast_ - outputFirst_ >= blockSize; outputFirst_ += blockSize) {
+      push(output_.data() + outputFirst_, blockSize);
+    }
+    done += n;
+  }
+}
+
+template<typename T>
+template<typename Pull>
+void DeviceResampler<T>::pull(T* samples, size_t count, Pull pull)
+{
+  count -= count % channelCount_;
+  for(size_t done = 0; done < count;) {
+    // the filter holds back its first output frames, so a block may not yield any
+    if(outputFirst_ == outputLast_) {
+      pull(block_.data(), block_.size());
+      process(block_.data(), frameCount_);
+      continue;
+    }
+
+    const auto n = std::min(count - done, outputLast_ - outputFirst_);
+    (void)std::copy(output_.data() + outputFirst_, output_.data() + outputFirst_ + n, samples + done);
+    outputFirst_ += n;
+    done += n;
+  }
+}
+
+template<typename T>
+void DeviceResampler<T>::process(const T* samples, size_t frameCount)
+{
+  // less than one block is left over, so the new frames always fit behind it
+  (void)std::copy(output_.data() + outputFirst_, output_.data() + outputLast_, output_.data());
+  outputLast_ -= outputFirst_;
+  outputFirst_ = 0;
+
+  convert(samples, frameCount * channelCount_, input_.data());
+  const auto count = resampler_.process(input_.data(), frameCount, resampled_.data()) * channelCount_;
+  convert(resampled_.data(), count, output_.data() + outputLast_);
+  outputLast_ += count;
+}
+
+template<typename T>
+DeviceCapture<T>::DeviceCapture(const Metadata& metadata, OverflowPolicy policy, std::shared_ptr<Backend> backend)
+  : backend_(std::move(backend))
+  , seq_{metadata, {}, {}}
+  , policy_(policy)
+  , isStreaming_(false)
+  , overruns_(0)
 {
   const SDL_AudioSpec want = {
     metadata.sampleRate,                   /**< DSP frequency -- samples per second */
@@ -63,20 +159,16 @@ DeviceCapture<T>::DeviceCapture(const Metadata& metadata)
     this                                   /**< Userdata passed to callback (ignored for NULL callbacks). */
   };
 
-  static const int isCapture = SDL_TRUE;
-
-  detail::printDevices(isCapture);
-
-  SDL_AudioSpec have;
-  deviceId_ = SDL_OpenAudioDevice(nullptr, isCapture, &want, &have, detail::allowedAudioChange);
-  if(!detail::isValid(deviceId_))
-    throw std::runtime_error(std::string("Failed to open audio: ") + SDL_GetError());
+  static const bool isCapture = true;
+  const auto opened = backend_->open(isCapture, want);
+  deviceId_ = opened.id;
+  resampler_ = detail::deviceResampler<T>(isCapture, metadata, opened.spec);
 }
 
 template<typename T>
 DeviceCapture<T>::~DeviceCapture()
 {
-  SDL_CloseAudioDevice(deviceId_);
+  backend_->close(deviceId_);
 }
 
 template<typename T>
@@ -89,16 +181,143 @@ Sequence<T> DeviceCapture<T>::record(std::chrono::milliseconds length)
 template<typename T>
 Sequence<T> DeviceCapture<T>::record(uint32_t lengthMsec)
 {
+  return record(lengthMsec, std::numeric_limits<size_t>::max());
+}
+
+template<typename T>
+Sequence<T> DeviceCapture<T>::record(std::chrono::milliseconds length, std::chrono::milliseconds residentLength)
+{
+  using Msec = std::chrono::duration<uint32_t, std::milli>;
+  const auto& metadata = seq_.metadata;
+  const auto residentCount = static_cast<size_t>(residentLength.count() * metadata.sampleRate / 1000 / metadata.sampleCount);
+  return record(std::chrono::duration_cast<Msec>(length).count(), std::max<size_t>(2, residentCount));
+}
+
+template<typename T>
+Sequence<T> DeviceCapture<T>::record(uint32_t lengthMsec, size_t residentCount)
+{
+  if(isStreaming_) {
+    throw std::logic_error("Cannot record while continuous capture is running");
+  }
+
   std::cout << "recording for " << lengthMsec << "ms ..." << std::endl;
 
-  SDL_PauseAudioDevice(deviceId_, detail::pauseDisable);
+  // preallocate all capture groups up front; the device callback only copies
+  const auto& metadata = seq_.metadata;
+  const auto blockSize = metadata.groupSize();
+  const auto sampleCount = static_cast<uint64_t>(lengthMsec) * metadata.sampleRate / 1000;
+  const auto blockCount = static_cast<size_t>((sampleCount + metadata.sampleCount - 1) / metadata.sampleCount);
+
+  // unless the whole recording fits, memory is split between the pool
+  // and the groups collected until they are spilled to disk in one write
+  const auto isBounded = (residentCount < blockCount);
+  const auto spillCount = residentCount / 2;
+  pool_.reset(blockSize, (isBounded ? residentCount - spillCount : blockCount) + detail::poolSlackBlockCount);
+
+  backend_->pause(deviceId_, false);
+
+  // block here for the duration of the recording,
+  // collecting filled groups and allocating new ones outside the device callback
+  try {
+    const auto startTicks = backend_->ticks();
+    for(uint32_t elapsed = 0; elapsed < lengthMsec; elapsed = backend_->ticks() - startTicks) {
+      backend_->delay(std::min(detail::poolServiceIntervalMsec, lengthMsec - elapsed));
+
+      if((policy_ == OverflowPolicy::Signal) && pool_.dropped()) {
+        break;
+      }
+      if(policy_ == OverflowPolicy::Grow || isBounded) {
+        (void)pool_.harvest(seq_.storage);
+        pool_.replenish();
+      }
+      if(isBounded && seq_.storage.size() >= spillCount) {
+        seq_.spill(0);
+      }
+    }
+  } catch(...) {
+    backend_->pause(deviceId_, true);
+    throw;
+  }
+
+  backend_->pause(deviceId_, true);
+
+  (void)pool_.harvest(seq_.storage);
+
+  if(const auto dropped = pool_.dropped()) {
+    if(policy_ == OverflowPolicy::Signal) {
+      seq_.storage.clear();
+      seq_.spilled = Spilled<T>();
+      throw std::runtime_error("Capture pool exhausted: " + std::to_string(dropped) + " groups dropped");
+    }
+    std::cerr << "capture pool exhausted: " << dropped << " groups dropped" << std::endl;
+  }
+
+  return Sequence<T>{seq_.metadata, std::move(seq_.storage), std::exchange(seq_.spilled, Spilled<T>())};
+}
+
+template<typename T>
+void DeviceCapture<T>::start(std::chrono::milliseconds bufferLength)
+{
+  using Msec = std::chrono::duration<uint32_t, std::milli>;
+  start(std::chrono::duration_cast<Msec>(bufferLength).count());
+}
+
+template<typename T>
+void DeviceCapture<T>::start(uint32_t bufferLengthMsec)
+{
+  if(isStreaming_) {
+    return;
+  }
+
+  // hold at least two device buffers so the reader has one buffer period of slack
+  const auto& metadata = seq_.metadata;
+  const auto bufferSampleCount = static_cast<uint64_t>(bufferLengthMsec) * metadata.sampleRate / 1000;
+  const auto deviceSampleCount = static_cast<uint64_t>(metadata.sampleCount);
+  ring_.reset(static_cast<size_t>(std::max(bufferSampleCount, 2 * deviceSampleCount) * metadata.channelCount));
+  overruns_ = 0;
+
+  isStreaming_ = true;
+  backend_->pause(deviceId_, false);
+}
+
+template<typename T>
+void DeviceCapture<T>::stop()
+{
+  backend_->pause(deviceId_, true);
+  isStreaming_ = false;
+}
+
+template<typename T>
+size_t DeviceCapture<T>::read(T* samples, size_t count)
+{
+  size_t done = 0;
+  for(;;) {
+    done += ring_.read(samples + done, count - done);
+    if((done == count) || !isStreaming_) {
+      break;
+    }
+
+    // wait for roughly the missing samples, but at least one tick
+    // and never so long that the ring buffer would overrun meanwhile
+    const auto missing = std::min(count - done, ring_.capacity() / 2);
+    const auto missingMsec = 1000 * missing / (seq_.metadata.sampleRate * seq_.metadata.channelCount);
+    backend_->delay(std::max(static_cast<uint32_t>(missingMsec), 1U));
+  }
 
-  // block here for the duration of the recording
-  SDL_Delay(lengthMsec);
+  // pick up what arrived before the device was stopped
+  return done + ring_.read(samples + done, count - done);
+}
 
-  SDL_PauseAudioDevice(deviceId_, detail::pauseEnable);
+template<typename T>
+size_t DeviceCapture<T>::tryRead(T* samples, size_t count)
+{
+  return ring_.read(samples, count);
+}
 
-  return Sequence<T>{seq_.metadata, std::move(seq_.storage)};
+template<typename T>
+size_t DeviceCapture<T>::overruns() const
+{
+  return overruns_;
 }
 
 template<typename T>
@@ -111,12 +330,40 @@ void DeviceCapture<T>::deviceCallback(void* userdata, uint8_t* stream, int len)
 template<typename T>
 void DeviceCapture<T>::deviceCallback(uint8_t* stream, int len)
 {
-  seq_.push(stream, len);
+  const auto first = reinterpret_cast<const T*>(stream);
+  const auto last = reinterpret_cast<const T*>(stream + len);
+
+  if(resampler_) {
+    resampler_->push(first, static_cast<size_t>(last - first), [this](const T* samples, size_t count) {
+      capture(samples, samples + count);
+    });
+    return;
+  }
+  capture(first, last);
+}
+
+template<typename T>
+void DeviceCapture<T>::capture(const T* first, const T* last)
+{
+  if(isStreaming_.load(std::memory_order_relaxed)) {
+    const auto count = static_cast<size_t>(last - first);
+    overruns_.fetch_add(count - ring_.write(first, count), std::memory_order_relaxed);
+    return;
+  }
+
+  // overflow is accounted for by the pool and handled in record()
+  (void)pool_.write(first, last, seq_.metadata.channelCount);
 }
 
 
 template<typename T>
-DevicePlayback<T>::DevicePlayback(const Metadata& metadata)
+DevicePlayback<T>::DevicePlayback(const Metadata& metadata, std::shared_ptr<Backend> backend)
+  : backend_(std::move(backend))
+  , pending_(detail::playbackQueueCapacity)
+  , finished_(detail::playbackQueueCapacity + 1)
+  , current_(nullptr)
+  , queuedCount_(0)
+  , isClosing_(false)
 {
   const SDL_AudioSpec want = {
     metadata.sampleRate,                    /**< DSP frequency -- samples per second */
@@ -130,33 +377,113 @@ DevicePlayback<T>::DevicePlayback(const Metadata& metadata)
     this                                    /**< Userdata passed to callback (ignored for NULL callbacks). */
   };
 
-  static const int isCapture = SDL_FALSE;
+  static const bool isCapture = false;
+  const auto opened = backend_->open(isCapture, want);
+  deviceId_ = opened.id;
+  resampler_ = detail::deviceResampler<T>(isCapture, metadata, opened.spec);
 
-  detail::printDevices(isCapture);
+  // keep the device running; the callback plays silence whenever the queue is empty
+  backend_->pause(deviceId_, false);
 
-  SDL_AudioSpec have;
-  deviceId_ = SDL_OpenAudioDevice(nullptr, isCapture, &want, &have, detail::allowedAudioChange);
-  if(!detail::isValid(deviceId_))
-    throw std::runtime_error(std::string("Failed to open audio: ") + SDL_GetError());
+  thread_ = std::thread(&DevicePlayback::run, this);
 }
 
 template<typename T>
 DevicePlayback<T>::~DevicePlayback()
 {
-  SDL_CloseAudioDevice(deviceId_);
+  backend_->close(deviceId_);
+  isClosing_ = true;
+  thread_.join();
+
+  // the device callback and the reclaiming thread are gone; pending futures report broken promises
+  reclaim();
+  delete current_;
+  Entry* entry;
+  while(pending_.read(&entry, 1)) {
+    delete entry;
+  }
 }
 
 template<typename T>
-void DevicePlayback<T>::play(Sequence<T> seq)
+void DevicePlayback<T>::play(const Sequence<T>& seq)
 {
-  seq_ = std::move(seq);
+  std::cout << "playback for " << seq.duration().count() << "ms ..." << std::endl;
 
-  std::cout << "playback for " << seq_.duration().count() << "ms ..." << std::endl;
-
-  SDL_PauseAudioDevice(deviceId_, detail::pauseDisable);
+  // blocking until done keeps the borrowed sequence alive for the device callback
+  const auto borrowed = std::shared_ptr<const Sequence<T>>(&seq, [](const Sequence<T>*) {});
 
   // block here for the duration of the playback
-  SDL_Delay(seq_.duration().count());
+  wait(enqueue(borrowed));
+}
+
+template<typename T>
+std::future<void> DevicePlayback<T>::enqueue(Sequence<T> seq)
+{
+  return enqueue(std::make_shared<const Sequence<T>>(std::move(seq)));
+}
+
+template<typename T>
+std::future<void> DevicePlayback<T>::enqueue(std::shared_ptr<const Sequence<T>> seq)
+{
+  return enqueue(std::unique_ptr<Source<T>>(new SequenceSource<T>(std::move(seq))));
+}
+
+template<typename T>
+template<typename Mapping>
+std::future<void> DevicePlayback<T>::enqueue(View<Mapping> view)
+{
+  return enqueue(std::unique_ptr<Source<T>>(new ViewSource<T, Mapping>(std::move(view))));
+}
+
+template<typename T>
+std::future<void> DevicePlayback<T>::enqueue(std::unique_ptr<Source<T>> source)
+{
+  // entries are only counted as done once reclaimed, so finished_ cannot overflow
+  if(queuedCount_ >= detail::playbackQueueCapacity) {
+    throw std::runtime_error("Playback queue full");
+  }
+
+  std::unique_ptr<Entry> entry(new Entry{std::move(source), {}});
+  auto done = entry->done.get_future();
+
+  auto ptr = entry.get();
+  if(!pending_.write(&ptr, 1)) {
+    throw std::runtime_error("Playback queue full");
+  }
+  (void)entry.release();
+  ++queuedCount_;
+
+  return done;
+}
+
+template<typename T>
+void DevicePlayback<T>::wait(const std::future<void>& done)
+{
+  for(reclaim(); done.wait_for(std::chrono::seconds(0)) != std::future_status::ready; reclaim()) {
+    backend_->delay(detail::playbackWaitIntervalMsec);
+  }
+}
+
+template<typename T>
+void DevicePlayback<T>::reclaim()
+{
+  // promises are fulfilled here rather than in the device callback, as that may lock and wake threads
+  std::lock_guard<std::mutex> lock(reclaimMutex_);
+  Entry* entry;
+  while(finished_.read(&entry, 1)) {
+    entry->done.set_value();
+    delete entry;
+    --queuedCount_;
+  }
+}
+
+template<typename T>
+void DevicePlayback<T>::run()
+{
+  while(!isClosing_) {
+    reclaim();
+    std::this_thread::sleep_for(std::chrono::milliseconds(detail::playbackReclaimIntervalMsec));
+  }
 }
 
 template<typename T>
@@ -169,19 +496,36 @@ void DevicePlayback<T>::deviceCallback(void* userdata, uint8_t* stream, int len)
 template<typename T>
 void DevicePlayback<T>::deviceCallback(uint8_t* stream, int len)
 {
-  auto samples = seq_.pop();
-  if(samples.empty()) {
-    SDL_PauseAudioDevice(deviceId_, detail::pauseEnable);
+  const auto samples = reinterpret_cast<T*>(stream);
+  const auto count = static_cast<size_t>(len) / sizeof(T);
+
+  if(resampler_) {
+    resampler_->pull(samples, count, [this](T* block, size_t blockSize) {
+      render(block, blockSize);
+    });
     return;
   }
+  render(samples, count);
+}
 
-  const auto first = reinterpret_cast<uint8_t*>(samples.data());
-  const size_t byteSize = samples.size() * sizeof(T);
-
-  const auto writeByteSize = std::min(byteSize, static_cast<size_t>(len));
+template<typename T>
+void DevicePlayback<T>::render(T* samples, size_t count)
+{
+  // continue seamlessly with the next queued source within the same buffer
+  while(count && (current_ || pending_.read(&current_, 1))) {
+    const auto n = current_->source->read(samples, count);
+    samples += n;
+    count -= n;
+
+    // a short read marks the end of the source
+    if(count) {
+      (void)finished_.write(&current_, 1);
+      current_ = nullptr;
+    }
+  }
 
-  memcpy(stream, first, writeByteSize);
-  memset(stream + writeByteSize, 0, static_cast<size_t>(len) - writeByteSize);
+  // play silence while idle
+  std::fill(samples, samples + count, detail::FormatLookUp<T>::silence());
 }
 
 } // namespace audio
@@ -0,0 +1,225 @@
+#include "AudioDuplex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audio {
+
+namespace {
+  // weight of the latest fill level measurement
+  const double fillSmoothing = 0.1;
+
+  // resampling ratio correction per relative fill level error
+  const double driftGain = 0.01;
+
+  // bound of the resampling ratio correction; real clock drift is far below
+  const double maxCorrection = 0.005;
+
+  // frames of previous and next sample kept between playback buffers
+  const size_t historyFrames = 2;
+
+  SDL_AudioSpec deviceSpec(const Metadata& metadata, SDL_AudioCallback callback, void* userdata)
+  {
+    return SDL_AudioSpec{
+      metadata.sampleRate,                   /**< DSP frequency -- samples per second */
+      detail::FormatLookUp<float>::format,   /**< Audio data format */
+      metadata.channelCount,                 /**< Number of channels: 1 mono, 2 stereo */
+      detail::audioSpecSilence,              /**< Audio buffer silence value (calculated) */
+      metadata.sampleCount,                  /**< Audio buffer size in sample FRAMES (total samples divided by channel count) */
+      detail::audioSpecPadding,              /**< Necessary for some compile environments */
+      detail::audioSpecSize,                 /**< Audio buffer size in bytes (calculated) */
+      callback,                              /**< Callback that feeds the audio device (NULL to use SDL_QueueAudio()). */
+      userdata                               /**< Userdata passed to callback (ignored for NULL callbacks). */
+    };
+  }
+} // namespace
+
+Duplex::Duplex(
+    const Metadata& metadata,
+    std::chrono::milliseconds targetLatency,
+    Processor processor,
+    std::shared_ptr<Backend> backend)
+  : backend_(std::move(backend))
+  , metadata_(metadata)
+  , processor_(std::move(processor))
+  , targetFrames_(std::max(static_cast<double>(historyFrames), static_cast<double>(targetLatency.count()) * metadata.sampleRate / 1000))
+  , input_((historyFrames + static_cast<size_t>(std::ceil(metadata.sampleCount * (1 + maxCorrection))) + 1) * metadata.channelCount)
+  , isPrimed_(false)
+  , position_(0.0)
+  , filteredFill_(0.0)
+  , ratio_(1.0)
+  , fill_(0)
+  , underruns_(0)
+  , overruns_(0)
+{
+  // room for twice the target plus a device buffer on either side
+  jitter_.reset((2 * static_cast<size_t>(targetFrames_) + 2 * metadata.sampleCount) * metadata.channelCount);
+
+  static const bool isCapture = true;
+  const auto playback = backend_->open(!isCapture, deviceSpec(metadata, Duplex::playbackCallback, this));
+  playbackId_ = playback.id;
+  try {
+    playbackResampler_ = detail::deviceResampler<float>(!isCapture, metadata, playback.spec);
+    const auto capture = backend_->open(isCapture, deviceSpec(metadata, Duplex::captureCallback, this));
+    captureId_ = capture.id;
+    captureResampler_ = detail::deviceResampler<float>(isCapture, metadata, capture.spec);
+  } catch(...) {
+    backend_->close(playbackId_);
+    throw;
+  }
+}
+
+Duplex::~Duplex()
+{
+  backend_->close(captureId_);
+  backend_->close(playbackId_);
+}
+
+void Duplex::start()
+{
+  backend_->pause(playbackId_, false);
+  backend_->pause(captureId_, false);
+}
+
+void Duplex::stop()
+{
+  backend_->pause(captureId_, true);
+  backend_->pause(playbackId_, true);
+}
+
+DuplexStats Duplex::stats() const
+{
+  const auto frames = fill_.load() + 2 * static_cast<size_t>(metadata_.sampleCount);
+  return DuplexStats{
+    std::chrono::microseconds(static_cast<int64_t>(frames) * 1000000 / metadata_.sampleRate),
+    ratio_.load(),
+    underruns_.load(),
+    overruns_.load()
+  };
+}
+
+void Duplex::captureCallback(void* userdata, uint8_t* stream, int len)
+{
+  auto instance = reinterpret_cast<Duplex*>(userdata);
+  instance->captureCallback(stream, len);
+}
+
+void Duplex::captureCallback(uint8_t* stream, int len)
+{
+  const auto samples = reinterpret_cast<const float*>(stream);
+  const auto count = static_cast<size_t>(len) / sizeof(float);
+
+  // drop what does not fit; never block the device thread
+  const auto write = [this](const float* block, size_t blockSize) {
+    const auto written = jitter_.write(block, blockSize);
+    if(written < blockSize) {
+      overruns_ += blockSize - written;
+    }
+  };
+  if(captureResampler_) {
+    captureResampler_->push(samples, count, write);
+  } else {
+    write(samples, count);
+  }
+}
+
+void Duplex::playbackCallback(void* userdata, uint8_t* stream, int len)
+{
+  auto instance = reinterpret_cast<Duplex*>(userdata);
+  instance->playbackCallback(stream, len);
+}
+
+void Duplex::playbackCallback(uint8_t* stream, int len)
+{
+  const auto out = reinterpret_cast<float*>(stream);
+  const auto count = static_cast<size_t>(len) / sizeof(float);
+
+  if(playbackResampler_) {
+    playbackResampler_->pull(out, count, [this](float* block, size_t blockSize) {
+      render(block, blockSize);
+    });
+    return;
+  }
+  render(out, count);
+}
+
+void Duplex::render(float* out, size_t count)
+{
+  const size_t channelCount = metadata_.channelCount;
+
+  // resample in chunks of at most one device buffer, as the input buffer is sized for
+  for(size_t done = 0; done < count;) {
+    const auto frameCount = std::min<size_t>(metadata_.sampleCount, (count - done) / channelCount);
+    if(frameCount == 0) {
+      break;
+    }
+
+    if(!resample(out + done, frameCount)) {
+      std::fill(out + done, out + count, 0.f);
+      break;
+    }
+    done += frameCount * channelCount;
+  }
+
+  if(processor_) {
+    processor_(out, count);
+  }
+}
+
+bool Duplex::resample(float* out, size_t frameCount)
+{
+  const size_t channelCount = metadata_.channelCount;
+  auto fill = jitter_.readAvailable() / channelCount;
+  fill_ = fill;
+
+  // wait for the target fill before (re-)starting
+  if(!isPrimed_) {
+    if(static_cast<double>(fill) < targetFrames_ || fill < historyFrames) {
+      return false;
+    }
+    (void)jitter_.read(input_.data(), historyFrames * channelCount);
+    fill -= historyFrames;
+    position_ = 0.0;
+    filteredFill_ = static_cast<double>(fill);
+    isPrimed_ = true;
+  }
+
+  // consume faster above the target fill and slower below
+  filteredFill_ += fillSmoothing * (static_cast<double>(fill) - filteredFill_);
+  const auto error = (filteredFill_ - targetFrames_) / targetFrames_;
+  const auto ratio = 1.0 + std::min(std::max(driftGain * error, -maxCorrection), maxCorrection);
+  ratio_ = ratio;
+
+  // the previous and next frame are kept; the last output interpolates up to frame (end + 1)
+  const auto end = position_ + static_cast<double>(frameCount) * ratio;
+  const auto newFrames = static_cast<size_t>(end);
+  if(fill < newFrames) {
+    ++underruns_;
+    isPrimed_ = false;
+    return false;
+  }
+  (void)jitter_.read(input_.data() + historyFrames * channelCount, newFrames * channelCount);
+
+  // linear interpolation between neighbouring frames
+  for(size_t f = 0; f < frameCount; ++f) {
+    const auto x = position_ + static_cast<double>(f) * ratio;
+    const auto i = static_cast<size_t>(x);
+    const auto weight = static_cast<float>(x - static_cast<double>(i));
+    const auto lhs = input_.data() + i * channelCount;
+    const auto rhs = lhs + channelCount;
+    for(size_t c = 0; c < channelCount; ++c) {
+      out[f * channelCount + c] = lhs[c] + weight * (rhs[c] - lhs[c]);
+    }
+  }
+
+  // keep the frames around the new position for the next buffer
+  (void)std::copy(
+        input_.data() + newFrames * channelCount,
+        input_.data() + (newFrames + historyFrames) * channelCount,
+        input_.data());
+  position_ = end - static_cast<double>(newFrames);
+
+  return true;
+}
+
+} // namespace audio
@@ -0,0 +1,85 @@
+#ifndef AUDIO_DUPLEX_H
+#define AUDIO_DUPLEX_H
+
+#include "AudioBackend.h"
+#include "AudioDevice.h"
+#include "AudioRingBuffer.h"
+#include "AudioSequence.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace audio {
+
+struct DuplexStats
+{
+  std::chrono::microseconds latency; ///< jitter buffer fill plus one capture and one playback device buffer
+  double ratio; ///< current resampling ratio, captured per played sample
+  size_t underruns; ///< number of playback buffers filled with silence for lack of captured samples
+  size_t overruns; ///< number of captured samples dropped for lack of jitter buffer space
+};
+
+/// forward capture to playback through a lock-free jitter buffer held at a target latency;
+/// clock drift between the devices is absorbed by adaptive fractional resampling
+/// @note  devices running at another rate than requested are resampled to it first, so the processor always
+///        sees the requested rate
+struct Duplex
+{
+  /// in-place processing of interleaved samples in the playback callback
+  using Processor = std::function<void(float* samples, size_t count)>;
+
+  /// @param targetLatency  jitter buffer fill to keep; at least one device buffer is recommended
+  Duplex(const Metadata& metadata,
+         std::chrono::milliseconds targetLatency,
+         Processor processor = Processor(),
+         std::shared_ptr<Backend> backend = defaultBackend());
+  Duplex(const Duplex&) = delete;
+  Duplex(Duplex&&) = delete;
+  ~Duplex();
+
+  void start();
+  void stop();
+
+  DuplexStats stats() const;
+
+private:
+  static void captureCallback(void* userdata, uint8_t* stream, int len);
+  void captureCallback(uint8_t* stream, int len);
+
+  static void playbackCallback(void* userdata, uint8_t* stream, int len);
+  void playbackCallback(uint8_t* stream, int len);
+
+  /// fill samples at the requested rate from the jitter buffer and process them
+  void render(float* out, size_t count);
+
+  /// resample frameCount frames from the jitter buffer into out
+  /// @return  false on underrun
+  bool resample(float* out, size_t frameCount);
+
+private:
+  std::shared_ptr<Backend> backend_;
+  Metadata metadata_;
+  Processor processor_;
+  double targetFrames_;
+  RingBuffer<float> jitter_; ///< interleaved captured samples
+  std::vector<float> input_; ///< previous and next frame followed by the frames read for one buffer
+  bool isPrimed_; ///< the jitter buffer reached the target fill since the last underrun
+  double position_; ///< fractional position between previous and next frame
+  double filteredFill_; // [frames]
+  std::atomic<double> ratio_;
+  std::atomic<size_t> fill_; // [frames]
+  std::atomic<size_t> underruns_;
+  std::atomic<size_t> overruns_;
+  Backend::DeviceId captureId_;
+  Backend::DeviceId playbackId_;
+  std::unique_ptr<DeviceResampler<float>> captureResampler_; ///< if the capture device runs at another rate
+  std::unique_ptr<DeviceResampler<float>> playbackResampler_; ///< if the playback device runs at another rate
+};
+
+} // namespace audio
+
+#endif // AUDIO_DUPLEX_H
@@ -0,0 +1,130 @@
+#include "AudioEcho.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_ECHO_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_ECHO_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  /// read count frames of a delay line, interpolating between line[i] and the newer line[i + 1],
+  /// and accumulate them into wet and feedback
+  void mixTap(const float* line, size_t count, float fraction, float gain, float feedback, float* wet, float* fb)
+  {
+    size_t i = 0;
+#if defined(AUDIO_ECHO_SSE2)
+    {
+      const auto f = _mm_set1_ps(fraction);
+      const auto g = _mm_set1_ps(gain);
+      const auto k = _mm_set1_ps(feedback);
+      for(; i + 4 <= count; i += 4) {
+        const auto older = _mm_loadu_ps(line + i);
+        const auto newer = _mm_loadu_ps(line + i + 1);
+        const auto tap = _mm_add_ps(newer, _mm_mul_ps(f, _mm_sub_ps(older, newer)));
+        _mm_storeu_ps(wet + i, _mm_add_ps(_mm_loadu_ps(wet + i), _mm_mul_ps(g, tap)));
+        _mm_storeu_ps(fb + i, _mm_add_ps(_mm_loadu_ps(fb + i), _mm_mul_ps(k, tap)));
+      }
+    }
+#endif
+#if defined(AUDIO_ECHO_NEON)
+    {
+      for(; i + 4 <= count; i += 4) {
+        const auto older = vld1q_f32(line + i);
+        const auto newer = vld1q_f32(line + i + 1);
+        const auto tap = vmlaq_n_f32(newer, vsubq_f32(older, newer), fraction);
+        vst1q_f32(wet + i, vmlaq_n_f32(vld1q_f32(wet + i), tap, gain));
+        vst1q_f32(fb + i, vmlaq_n_f32(vld1q_f32(fb + i), tap, feedback));
+      }
+    }
+#endif
+    for(; i < count; ++i) {
+      const auto tap = line[i + 1] + fraction * (line[i] - line[i + 1]);
+      wet[i] += gain * tap;
+      fb[i] += feedback * tap;
+    }
+  }
+} // namespace
+
+Echo::Echo(const Metadata& metadata, std::vector<Tap> taps, float mix)
+  : channelCount_(metadata.channelCount)
+  , mix_(mix)
+  , runLength_(metadata.sampleCount)
+  , lineLength_(0)
+  , head_(0)
+  , dry_(metadata.sampleCount)
+  , wet_(metadata.sampleCount)
+  , feedback_(metadata.sampleCount)
+{
+  if(taps.empty() || channelCount_ == 0 || runLength_ == 0) {
+    throw std::runtime_error("Invalid echo settings");
+  }
+
+  for(auto&& tap : taps) {
+    const auto delay = tap.delay * metadata.sampleRate / 1000.0;
+    if(!(delay >= 1.0)) {
+      throw std::runtime_error("Echo delay shorter than one frame");
+    }
+    const auto frames = std::floor(delay);
+    readers_.push_back(Reader{static_cast<size_t>(frames), static_cast<float>(delay - frames), tap.gain, tap.feedback});
+
+    // a run must not read the frames it writes
+    runLength_ = std::min(runLength_, readers_.back().delay);
+    lineLength_ = std::max(lineLength_, readers_.back().delay + 1);
+  }
+
+  lines_.resize(channelCount_ * 2 * lineLength_);
+}
+
+void Echo::process(float* samples, size_t count)
+{
+  auto frames = count / channelCount_;
+  while(frames > 0) {
+    const auto n = std::min(frames, runLength_);
+    for(size_t c = 0; c < channelCount_; ++c) {
+      for(size_t i = 0; i < n; ++i) {
+        dry_[i] = samples[i * channelCount_ + c];
+      }
+      (void)std::copy(dry_.data(), dry_.data() + n, feedback_.data());
+      std::fill(wet_.data(), wet_.data() + n, 0.f);
+
+      // frames one further back than the delay are needed for the interpolation
+      const auto line = lines_.data() + c * 2 * lineLength_;
+      for(auto&& reader : readers_) {
+        const auto first = (head_ + lineLength_ - reader.delay - 1) % lineLength_;
+        mixTap(line + first, n, reader.fraction, reader.gain, reader.feedback, wet_.data(), feedback_.data());
+      }
+
+      // both copies of the line are written, possibly wrapping around once
+      const auto split = std::min(n, lineLength_ - head_);
+      (void)std::copy(feedback_.data(), feedback_.data() + split, line + head_);
+      (void)std::copy(feedback_.data(), feedback_.data() + split, line + lineLength_ + head_);
+      (void)std::copy(feedback_.data() + split, feedback_.data() + n, line);
+      (void)std::copy(feedback_.data() + split, feedback_.data() + n, line + lineLength_);
+
+      for(size_t i = 0; i < n; ++i) {
+        samples[i * channelCount_ + c] = dry_[i] + mix_ * (wet_[i] - dry_[i]);
+      }
+    }
+
+    head_ = (head_ + n) % lineLength_;
+    samples += n * channelCount_;
+    frames -= n;
+  }
+}
+
+void Echo::reset()
+{
+  std::fill(std::begin(lines_), std::end(lines_), 0.f);
+  head_ = 0;
+}
+
+} // namespace audio
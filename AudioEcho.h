@@ -0,0 +1,59 @@
+#ifndef AUDIO_ECHO_H
+#define AUDIO_ECHO_H
+
+#include "AudioSequence.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace audio {
+
+/// multi-tap feedback delay on a live interleaved stream: each tap reads a circular delay line
+/// at a fractional delay by linear interpolation, adds to the echo and feeds back into the line
+/// @note  taps are evaluated for whole runs of frames shorter than the shortest delay, with SSE2/NEON as enabled for the build
+struct Echo
+{
+  struct Tap
+  {
+    double delay; // [ms]
+    float gain; ///< contribution to the echo
+    float feedback; ///< contribution to the delay line; the sum over all taps has to stay below 1 for the echo to decay
+  };
+
+  /// @param mix  echo share of the output: 0 passes the input unchanged, 1 outputs the echo only
+  /// @throw std::runtime_error  without taps or for a tap delay shorter than one frame
+  Echo(const Metadata& metadata, std::vector<Tap> taps, float mix = 0.5f);
+
+  /// add the echo to interleaved samples in place
+  /// @note  does not allocate, so it may run in a device callback (e.g. as Duplex::Processor)
+  void process(float* samples, size_t count);
+  void operator()(float* samples, size_t count) { process(samples, count); }
+
+  /// restart from silence
+  void reset();
+
+private:
+  struct Reader
+  {
+    size_t delay; ///< integer part [frames]
+    float fraction; ///< weight of the frame one further back
+    float gain;
+    float feedback;
+  };
+
+private:
+  size_t channelCount_;
+  float mix_;
+  std::vector<Reader> readers_;
+  size_t runLength_; ///< frames processed at once, never reaching into frames written by the same run
+  size_t lineLength_; // [frames]
+  std::vector<float> lines_; ///< one delay line per channel, each stored twice in a row so any run is contiguous
+  size_t head_; ///< line position the next frame is written to
+  std::vector<float> dry_; ///< one channel of the current run
+  std::vector<float> wet_;
+  std::vector<float> feedback_;
+};
+
+} // namespace audio
+
+#endif // AUDIO_ECHO_H
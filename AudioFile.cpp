@@ -0,0 +1,228 @@
+#include "AudioFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace audio {
+
+namespace {
+  const size_t wavHeaderSize = 44;
+  const size_t chunkHeaderSize = 8;
+  const size_t fmtMinSize = 16;
+  const size_t fmtExtensibleSize = 40;
+  const size_t fmtSubFormatOffset = 24; // the subformat GUID starts with the format tag
+  const uint16_t wavFormatExtensible = 0xFFFE;
+  const uint64_t maxChunkSize = 0xFFFFFFFF;
+
+  // WAV files are little endian regardless of the host
+  uint16_t readU16(const uint8_t* p)
+  {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+  }
+
+  uint32_t readU32(const uint8_t* p)
+  {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  void writeU16(uint8_t* p, uint16_t value)
+  {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+  }
+
+  void writeU32(uint8_t* p, uint32_t value)
+  {
+    writeU16(p, static_cast<uint16_t>(value));
+    writeU16(p + 2, static_cast<uint16_t>(value >> 16));
+  }
+
+  bool isTag(const uint8_t* p, const char* tag)
+  {
+    return std::memcmp(p, tag, 4) == 0;
+  }
+} // namespace
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+  : data_(nullptr)
+  , size_(0)
+  , file_(INVALID_HANDLE_VALUE)
+  , mapping_(nullptr)
+{
+  const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  LARGE_INTEGER size;
+  if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+    if(file != INVALID_HANDLE_VALUE) {
+      (void)CloseHandle(file);
+    }
+    throw std::runtime_error("Failed to open " + path);
+  }
+
+  // empty files cannot be mapped
+  file_ = file;
+  size_ = static_cast<size_t>(size.QuadPart);
+  if(size_ == 0) {
+    return;
+  }
+
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  data_ = (mapping_ != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)) : nullptr);
+  if(data_ == nullptr) {
+    if(mapping_ != nullptr) {
+      (void)CloseHandle(mapping_);
+    }
+    (void)CloseHandle(file_);
+    throw std::runtime_error("Failed to map " + path);
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if(data_ != nullptr) {
+    (void)UnmapViewOfFile(data_);
+  }
+  if(mapping_ != nullptr) {
+    (void)CloseHandle(mapping_);
+  }
+  if(file_ != INVALID_HANDLE_VALUE) {
+    (void)CloseHandle(file_);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+  : data_(nullptr)
+  , size_(0)
+{
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if(fd < 0 || ::fstat(fd, &status) != 0) {
+    if(fd >= 0) {
+      (void)::close(fd);
+    }
+    throw std::runtime_error("Failed to open " + path);
+  }
+
+  // the mapping stays valid after closing the descriptor; empty files cannot be mapped
+  size_ = static_cast<size_t>(status.st_size);
+  void* data = (size_ > 0 ? ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr);
+  (void)::close(fd);
+  if(data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + path);
+  }
+
+  // samples are usually read front to back
+  if(data != nullptr) {
+    (void)::madvise(data, size_, MADV_SEQUENTIAL);
+  }
+  data_ = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+  if(data_ != nullptr) {
+    (void)::munmap(const_cast<uint8_t*>(data_), size_);
+  }
+}
+#endif // _WIN32
+
+const uint8_t* MappedFile::data() const
+{
+  return data_;
+}
+
+size_t MappedFile::size() const
+{
+  return size_;
+}
+
+WavHeader parseWav(const uint8_t* data, size_t size)
+{
+  if(size < 3 * 4 || !isTag(data, "RIFF") || !isTag(data + 8, "WAVE")) {
+    throw std::runtime_error("Not a WAV file");
+  }
+
+  WavHeader header{};
+  bool hasFormat = false;
+  for(size_t pos = 3 * 4; pos + chunkHeaderSize <= size;) {
+    const auto chunk = data + pos;
+    const auto body = pos + chunkHeaderSize;
+    const size_t chunkSize = readU32(chunk + 4);
+
+    if(isTag(chunk, "fmt ")) {
+      if(chunkSize < fmtMinSize || body + chunkSize > size) {
+        throw std::runtime_error("Invalid WAV format chunk");
+      }
+
+      const auto fmt = data + body;
+      header.formatTag = readU16(fmt);
+      header.metadata.channelCount = static_cast<uint8_t>(std::min<uint16_t>(readU16(fmt + 2), 0xFF));
+      header.metadata.sampleRate = static_cast<int>(readU32(fmt + 4));
+      header.bitsPerSample = readU16(fmt + 14);
+      if(header.formatTag == wavFormatExtensible && chunkSize >= fmtExtensibleSize) {
+        header.formatTag = readU16(fmt + fmtSubFormatOffset);
+      }
+      hasFormat = true;
+    } else if(isTag(chunk, "data")) {
+      if(!hasFormat) {
+        throw std::runtime_error("WAV data precedes format");
+      }
+
+      // unfinished and oversized recordings have no valid size, they extend to the end of the file
+      header.dataOffset = body;
+      const auto isOpenEnded = (chunkSize == 0 || chunkSize == maxChunkSize || body + chunkSize > size);
+      header.dataSize = (isOpenEnded ? size - body : chunkSize);
+      break;
+    }
+
+    // chunks are padded to even sizes
+    pos = body + chunkSize + (chunkSize & 1);
+  }
+
+  if(!hasFormat || header.dataOffset == 0) {
+    throw std::runtime_error("WAV file without samples");
+  }
+  if(header.formatTag != detail::wavFormatPcm && header.formatTag != detail::wavFormatFloat) {
+    throw std::runtime_error("Unsupported WAV encoding");
+  }
+  return header;
+}
+
+std::vector<uint8_t> wavHeader(const Metadata& metadata, uint16_t formatTag, uint16_t bitsPerSample, uint64_t dataSize)
+{
+  const auto blockAlign = static_cast<uint16_t>(metadata.channelCount * bitsPerSample / 8);
+  const auto riffSize = std::min(maxChunkSize, dataSize + wavHeaderSize - chunkHeaderSize);
+
+  std::vector<uint8_t> header(wavHeaderSize);
+  auto p = header.data();
+  std::memcpy(p, "RIFF", 4);
+  writeU32(p + 4, static_cast<uint32_t>(riffSize));
+  std::memcpy(p + 8, "WAVE", 4);
+
+  std::memcpy(p + 12, "fmt ", 4);
+  writeU32(p + 16, fmtMinSize);
+  writeU16(p + 20, formatTag);
+  writeU16(p + 22, metadata.channelCount);
+  writeU32(p + 24, static_cast<uint32_t>(metadata.sampleRate));
+  writeU32(p + 28, static_cast<uint32_t>(metadata.sampleRate) * blockAlign);
+  writeU16(p + 32, blockAlign);
+  writeU16(p + 34, bitsPerSample);
+
+  std::memcpy(p + 36, "data", 4);
+  writeU32(p + 40, static_cast<uint32_t>(std::min(maxChunkSize, dataSize)));
+  return header;
+}
+
+} // namespace audio
@@ -0,0 +1,171 @@
+#ifndef AUDIO_FILE_H
+#define AUDIO_FILE_H
+
+#include "AudioRingBuffer.h"
+#include "AudioSequence.h"
+#include "AudioView.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace audio {
+
+/// whole file mapped read-only into memory; pages are loaded by the OS on first access
+struct MappedFile
+{
+  /// @throw  std::runtime_error if the file cannot be opened or mapped
+  explicit MappedFile(const std::string& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  ~MappedFile();
+
+  const uint8_t* data() const;
+  size_t size() const;
+
+private:
+  const uint8_t* data_;
+  size_t size_;
+#ifdef _WIN32
+  void* file_;
+  void* mapping_;
+#endif // _WIN32
+};
+
+/// sample layout of a WAV file
+struct WavHeader
+{
+  Metadata metadata; ///< sampleRate and channelCount as stored, sampleCount as requested by the reader
+  uint16_t formatTag; ///< 1 for integer PCM, 3 for IEEE float
+  uint16_t bitsPerSample;
+  size_t dataOffset; ///< position of the first sample [bytes]
+  size_t dataSize; ///< length of the sample data [bytes]
+};
+
+/// parse the RIFF chunks of a WAV file up to its sample data
+/// @throw  std::runtime_error if this is no PCM or IEEE float WAV file
+WavHeader parseWav(const uint8_t* data, size_t size);
+
+/// canonical 44 byte header of a WAV file
+/// @note  sizes beyond the 4GB limit of the format are saturated
+std::vector<uint8_t> wavHeader(const Metadata& metadata, uint16_t formatTag, uint16_t bitsPerSample, uint64_t dataSize);
+
+enum class FileFormat
+{
+  Wav, ///< RIFF header followed by interleaved samples
+  Raw ///< interleaved samples only
+};
+
+namespace detail {
+  static const uint16_t wavFormatPcm = 1;
+  static const uint16_t wavFormatFloat = 3;
+  static const size_t fileWriterBatchSize = 1 << 16; // samples handed to the OS per write
+  static const uint32_t fileWriterPollIntervalMsec = 20;
+
+  /// WAV encoding of each sample type
+  template<typename T>
+  struct WavEncoding;
+  template<>
+  struct WavEncoding<uint8_t> { static const uint16_t formatTag = wavFormatPcm; };
+  template<>
+  struct WavEncoding<int16_t> { static const uint16_t formatTag = wavFormatPcm; };
+  template<>
+  struct WavEncoding<int32_t> { static const uint16_t formatTag = wavFormatPcm; };
+  template<>
+  struct WavEncoding<float> { static const uint16_t formatTag = wavFormatFloat; };
+
+  /// interleaved samples of a mapped file, addressed in the planar storage order of a Sequence
+  template<typename T>
+  struct Mapped
+  {
+    using value_type = T;
+
+    std::shared_ptr<const MappedFile> file; ///< keeps the mapping alive as long as any view on it
+    const T* samples;
+    size_t count;
+    Metadata metadata;
+
+    size_t size() const;
+    value_type operator[](size_t pos) const;
+  };
+} // namespace detail
+
+/// zero-copy view on the samples of a memory-mapped file, indexed like a Sequence of the same metadata
+/// (i.e. capture groups of planar channels), so channel(), slice(), materialize(), welch() etc. apply
+/// @note  the view shares ownership of the mapping, unlike views on sequences
+template<typename T>
+using FileView = View<detail::Mapped<T>>;
+
+/// map a WAV file whose samples are stored as T (8 bit unsigned, 16 or 32 bit signed PCM or 32 bit float)
+/// @param sampleCount  capture group size of the resulting view
+/// @throw  std::runtime_error if the file cannot be mapped or stores a different sample format
+template<typename T>
+FileView<T> mapWav(const std::string& path, uint16_t sampleCount = Metadata().sampleCount);
+
+/// map a headerless file of interleaved samples
+/// @throw  std::runtime_error if the file cannot be mapped
+template<typename T>
+FileView<T> mapRaw(const std::string& path, const Metadata& metadata);
+
+/// WAV or raw file written by a background thread in large batches;
+/// interleaved samples are handed over through a wait-free ring buffer,
+/// so a producer on the audio path never waits for the disk and memory stays constant
+template<typename T>
+struct FileWriter
+{
+  /// @param bufferLength  audio buffered for the writer thread to catch up
+  /// @throw  std::runtime_error if the file cannot be created
+  FileWriter(const std::string& path,
+             const Metadata& metadata,
+             FileFormat format = FileFormat::Wav,
+             std::chrono::milliseconds bufferLength = std::chrono::milliseconds(4000));
+  FileWriter(const FileWriter&) = delete;
+  FileWriter(FileWriter&&) = delete;
+  ~FileWriter();
+
+  /// append interleaved samples (single producer); neither blocks nor allocates
+  /// @return  number of samples accepted, less than count if the writer thread fell behind
+  size_t write(const T* samples, size_t count);
+
+  /// append all samples a streaming capture (see DeviceCapture::start()) has available right now
+  /// @return  number of samples read from the capture
+  template<typename Capture>
+  size_t pull(Capture& capture);
+
+  /// write the remaining samples, complete the header and stop the writer thread;
+  /// further samples are discarded
+  void close();
+
+  /// number of samples discarded because the writer thread did not keep up
+  size_t overruns() const;
+
+private:
+  void run();
+
+  /// write all buffered samples in batches
+  void drain();
+
+private:
+  Metadata metadata_;
+  FileFormat format_;
+  std::ofstream file_;
+  RingBuffer<T> ring_;
+  std::vector<T> batch_; ///< samples moved from the ring buffer to the file (writer thread only)
+  std::vector<T> interleaved_; ///< read buffer for pull()
+  uint64_t dataSize_; ///< [bytes]
+  std::atomic<bool> isClosing_;
+  std::atomic<size_t> overruns_;
+  std::thread thread_;
+};
+
+} // namespace audio
+
+#include "AudioFile_impl.h"
+
+#endif // AUDIO_FILE_H
@@ -0,0 +1,196 @@
+#ifndef AUDIO_FILE_IMPL_H
+#define AUDIO_FILE_IMPL_H
+
+#ifndef AUDIO_FILE_H
+#error "Include via AudioFile.h"
+#endif // AUDIO_FILE_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace audio {
+
+namespace detail {
+  template<typename T>
+  size_t Mapped<T>::size() const
+  {
+    return count;
+  }
+
+  template<typename T>
+  typename Mapped<T>::value_type Mapped<T>::operator[](size_t pos) const
+  {
+    const size_t channelCount = metadata.channelCount;
+    if(channelCount == 1) {
+      return samples[pos];
+    }
+
+    // the file interleaves whole frames, a sequence stores each capture group channel by channel
+    const auto groupSize = metadata.groupSize();
+    const auto groupFirst = pos - pos % groupSize;
+    const auto frames = std::min<size_t>(metadata.sampleCount, (count - groupFirst) / channelCount);
+    const auto offset = pos - groupFirst;
+    return samples[groupFirst + (offset % frames) * channelCount + offset / frames];
+  }
+
+  template<typename T>
+  FileView<T> mapSamples(std::shared_ptr<const MappedFile> file, size_t offset, size_t size, const Metadata& metadata)
+  {
+    if(metadata.sampleRate <= 0 || metadata.channelCount == 0 || metadata.sampleCount == 0) {
+      throw std::runtime_error("Invalid audio file metadata");
+    }
+    if(offset % alignof(T) != 0) {
+      throw std::runtime_error("Misaligned audio file samples");
+    }
+
+    // a trailing incomplete frame is ignored
+    const auto frameCount = std::min(size, file->size() - std::min(offset, file->size())) / sizeof(T) / metadata.channelCount;
+    const auto samples = reinterpret_cast<const T*>(file->data() + offset);
+    return {metadata, Mapped<T>{std::move(file), samples, frameCount * metadata.channelCount, metadata}};
+  }
+} // namespace detail
+
+template<typename T>
+FileView<T> mapWav(const std::string& path, uint16_t sampleCount)
+{
+  auto file = std::make_shared<const MappedFile>(path);
+  auto header = parseWav(file->data(), file->size());
+  if(header.formatTag != detail::WavEncoding<T>::formatTag || header.bitsPerSample != 8 * sizeof(T)) {
+    throw std::runtime_error("Unexpected sample format of " + path);
+  }
+
+  header.metadata.sampleCount = sampleCount;
+  return detail::mapSamples<T>(std::move(file), header.dataOffset, header.dataSize, header.metadata);
+}
+
+template<typename T>
+FileView<T> mapRaw(const std::string& path, const Metadata& metadata)
+{
+  auto file = std::make_shared<const MappedFile>(path);
+  const auto size = file->size();
+  return detail::mapSamples<T>(std::move(file), 0, size, metadata);
+}
+
+
+template<typename T>
+FileWriter<T>::FileWriter(const std::string& path,
+                          const Metadata& metadata,
+                          FileFormat format,
+                          std::chrono::milliseconds bufferLength)
+  : metadata_(metadata)
+  , format_(format)
+  , file_(path, std::ios::binary | std::ios::trunc)
+  , ring_(std::max(detail::fileWriterBatchSize,
+                   static_cast<size_t>(bufferLength.count() * metadata.sampleRate / 1000) * metadata.channelCount))
+  , batch_(detail::fileWriterBatchSize)
+  , interleaved_(metadata.groupSize())
+  , dataSize_(0)
+  , isClosing_(false)
+  , overruns_(0)
+{
+  if(!file_) {
+    throw std::runtime_error("Failed to create " + path);
+  }
+
+  // placeholder until the final size is known
+  if(format_ == FileFormat::Wav) {
+    const auto header = wavHeader(metadata_, detail::WavEncoding<T>::formatTag, 8 * sizeof(T), 0);
+    (void)file_.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+  }
+
+  thread_ = std::thread(&FileWriter::run, this);
+}
+
+template<typename T>
+FileWriter<T>::~FileWriter()
+{
+  try {
+    close();
+  } catch(const std::exception&) {
+    // errors are only reported to explicit close() calls
+  }
+}
+
+template<typename T>
+size_t FileWriter<T>::write(const T* samples, size_t count)
+{
+  const auto written = (isClosing_ ? 0 : ring_.write(samples, count));
+  if(written < count) {
+    overruns_ += count - written;
+  }
+  return written;
+}
+
+template<typename T>
+template<typename Capture>
+size_t FileWriter<T>::pull(Capture& capture)
+{
+  size_t total = 0;
+  for(;;) {
+    const auto count = capture.tryRead(interleaved_.data(), interleaved_.size());
+    (void)write(interleaved_.data(), count);
+    total += count;
+    if(count < interleaved_.size()) {
+      return total;
+    }
+  }
+}
+
+template<typename T>
+void FileWriter<T>::close()
+{
+  if(!thread_.joinable()) {
+    return;
+  }
+
+  isClosing_ = true;
+  thread_.join();
+
+  if(format_ == FileFormat::Wav) {
+    const auto header = wavHeader(metadata_, detail::WavEncoding<T>::formatTag, 8 * sizeof(T), dataSize_);
+    (void)file_.seekp(0);
+    (void)file_.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+  }
+  file_.close();
+  if(!file_) {
+    throw std::runtime_error("Failed to write audio file");
+  }
+}
+
+template<typename T>
+size_t FileWriter<T>::overruns() const
+{
+  return overruns_;
+}
+
+template<typename T>
+void FileWriter<T>::run()
+{
+  // only full batches are written while recording, keeping the number of system calls low
+  while(!isClosing_) {
+    if(ring_.readAvailable() >= batch_.size()) {
+      drain();
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(detail::fileWriterPollIntervalMsec));
+    }
+  }
+  drain();
+}
+
+template<typename T>
+void FileWriter<T>::drain()
+{
+  for(;;) {
+    const auto count = ring_.read(batch_.data(), batch_.size());
+    if(count == 0) {
+      return;
+    }
+    (void)file_.write(reinterpret_cast<const char*>(batch_.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    dataSize_ += count * sizeof(T);
+  }
+}
+
+} // namespace audio
+
+#endif // AUDIO_FILE_IMPL_H
@@ -0,0 +1,307 @@
+#include "AudioFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_FORMAT_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define AUDIO_FORMAT_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_FORMAT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  const float int16Scale = 32768.f;
+  const float int32Scale = 2147483648.f;
+  const float uint8Scale = 128.f;
+  const int uint8Offset = 128;
+
+  // largest float below 1; scaled to int32 it still fits
+  const float belowOne = 0.99999994f;
+
+  inline float clamp(float value, float max)
+  {
+    return std::min(std::max(value, -1.f), max);
+  }
+
+  inline int16_t toInt16(float value)
+  {
+    const auto scaled = std::lrint(clamp(value, 1.f) * int16Scale);
+    return static_cast<int16_t>(std::min(scaled, 32767L));
+  }
+
+  inline int32_t toInt32(float value)
+  {
+    return static_cast<int32_t>(std::llrint(clamp(value, belowOne) * int32Scale));
+  }
+
+  inline uint8_t toUint8(float value)
+  {
+    const auto scaled = std::lrint(clamp(value, 1.f) * uint8Scale) + uint8Offset;
+    return static_cast<uint8_t>(std::min(scaled, 255L));
+  }
+} // namespace
+
+void convert(const int16_t* src, size_t count, float* dst)
+{
+  size_t i = 0;
+#if defined(AUDIO_FORMAT_AVX2)
+  {
+    const auto scale = _mm256_set1_ps(1.f / int16Scale);
+    for(; i + 8 <= count; i += 8) {
+      const auto s = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+      _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_SSE2)
+  {
+    const auto scale = _mm_set1_ps(1.f / int16Scale);
+    for(; i + 8 <= count; i += 8) {
+      const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      // sign-extend by placing each sample in the upper half and shifting back
+      const auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+      const auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_NEON)
+  {
+    const float scale = 1.f / int16Scale;
+    for(; i + 8 <= count; i += 8) {
+      const auto s = vld1q_s16(src + i);
+      vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), scale));
+      vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), scale));
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i] = src[i] / int16Scale;
+  }
+}
+
+void convert(const int32_t* src, size_t count, float* dst)
+{
+  size_t i = 0;
+#if defined(AUDIO_FORMAT_AVX2)
+  {
+    const auto scale = _mm256_set1_ps(1.f / int32Scale);
+    for(; i + 8 <= count; i += 8) {
+      const auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_SSE2)
+  {
+    const auto scale = _mm_set1_ps(1.f / int32Scale);
+    for(; i + 4 <= count; i += 4) {
+      const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_NEON)
+  {
+    const float scale = 1.f / int32Scale;
+    for(; i + 4 <= count; i += 4) {
+      vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), scale));
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i] = static_cast<float>(src[i]) / int32Scale;
+  }
+}
+
+void convert(const uint8_t* src, size_t count, float* dst)
+{
+  size_t i = 0;
+#if defined(AUDIO_FORMAT_AVX2)
+  {
+    const auto offset = _mm256_set1_ps(static_cast<float>(uint8Offset));
+    const auto scale = _mm256_set1_ps(1.f / uint8Scale);
+    for(; i + 8 <= count; i += 8) {
+      const auto s = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+      _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(s), offset), scale));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_SSE2)
+  {
+    const auto zero = _mm_setzero_si128();
+    const auto offset = _mm_set1_ps(static_cast<float>(uint8Offset));
+    const auto scale = _mm_set1_ps(1.f / uint8Scale);
+    for(; i + 16 <= count; i += 16) {
+      const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      const auto lo = _mm_unpacklo_epi8(s, zero);
+      const auto hi = _mm_unpackhi_epi8(s, zero);
+      const __m128i words[4] = {
+        _mm_unpacklo_epi16(lo, zero),
+        _mm_unpackhi_epi16(lo, zero),
+        _mm_unpacklo_epi16(hi, zero),
+        _mm_unpackhi_epi16(hi, zero)
+      };
+      for(size_t j = 0; j < 4; ++j) {
+        _mm_storeu_ps(dst + i + 4 * j, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(words[j]), offset), scale));
+      }
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_NEON)
+  {
+    const auto offset = vdupq_n_f32(static_cast<float>(uint8Offset));
+    const float scale = 1.f / uint8Scale;
+    for(; i + 8 <= count; i += 8) {
+      const auto s = vmovl_u8(vld1_u8(src + i));
+      const auto lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(s)));
+      const auto hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(s)));
+      vst1q_f32(dst + i, vmulq_n_f32(vsubq_f32(lo, offset), scale));
+      vst1q_f32(dst + i + 4, vmulq_n_f32(vsubq_f32(hi, offset), scale));
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i] = (static_cast<int>(src[i]) - uint8Offset) / uint8Scale;
+  }
+}
+
+void convert(const float* src, size_t count, int16_t* dst)
+{
+  size_t i = 0;
+#if defined(AUDIO_FORMAT_AVX2)
+  {
+    const auto min = _mm256_set1_ps(-1.f);
+    const auto max = _mm256_set1_ps(1.f);
+    const auto scale = _mm256_set1_ps(int16Scale);
+    for(; i + 16 <= count; i += 16) {
+      const auto a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), min), max), scale);
+      const auto b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i + 8), min), max), scale);
+      // saturating pack works per 128 bit lane; restore sample order afterwards
+      const auto packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_SSE2)
+  {
+    const auto min = _mm_set1_ps(-1.f);
+    const auto max = _mm_set1_ps(1.f);
+    const auto scale = _mm_set1_ps(int16Scale);
+    for(; i + 8 <= count; i += 8) {
+      const auto a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), min), max), scale);
+      const auto b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), min), max), scale);
+      // saturating pack maps +1.0 to the largest int16
+      const auto packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_NEON)
+  {
+    const auto min = vdupq_n_f32(-1.f);
+    const auto max = vdupq_n_f32(1.f);
+    for(; i + 8 <= count; i += 8) {
+      const auto a = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), min), max), int16Scale);
+      const auto b = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), min), max), int16Scale);
+      vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i] = toInt16(src[i]);
+  }
+}
+
+void convert(const float* src, size_t count, int32_t* dst)
+{
+  size_t i = 0;
+#if defined(AUDIO_FORMAT_AVX2)
+  {
+    const auto min = _mm256_set1_ps(-1.f);
+    const auto max = _mm256_set1_ps(belowOne);
+    const auto scale = _mm256_set1_ps(int32Scale);
+    for(; i + 8 <= count; i += 8) {
+      const auto a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), min), max), scale);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtps_epi32(a));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_SSE2)
+  {
+    const auto min = _mm_set1_ps(-1.f);
+    const auto max = _mm_set1_ps(belowOne);
+    const auto scale = _mm_set1_ps(int32Scale);
+    for(; i + 4 <= count; i += 4) {
+      const auto a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), min), max), scale);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_epi32(a));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_NEON)
+  {
+    const auto min = vdupq_n_f32(-1.f);
+    const auto max = vdupq_n_f32(belowOne);
+    for(; i + 4 <= count; i += 4) {
+      const auto a = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), min), max), int32Scale);
+      vst1q_s32(dst + i, vcvtnq_s32_f32(a));
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i] = toInt32(src[i]);
+  }
+}
+
+void convert(const float* src, size_t count, uint8_t* dst)
+{
+  size_t i = 0;
+#if defined(AUDIO_FORMAT_SSE2)
+  {
+    const auto min = _mm_set1_ps(-1.f);
+    const auto max = _mm_set1_ps(1.f);
+    const auto scale = _mm_set1_ps(uint8Scale);
+    const auto offset = _mm_set1_epi16(uint8Offset);
+    for(; i + 16 <= count; i += 16) {
+      __m128i words[4];
+      for(size_t j = 0; j < 4; ++j) {
+        const auto s = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4 * j), min), max), scale);
+        words[j] = _mm_cvtps_epi32(s);
+      }
+      // [-128, 128] shifted to [0, 256], the unsigned saturating pack clips +1.0 to 255
+      const auto lo = _mm_add_epi16(_mm_packs_epi32(words[0], words[1]), offset);
+      const auto hi = _mm_add_epi16(_mm_packs_epi32(words[2], words[3]), offset);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+  }
+#endif
+#if defined(AUDIO_FORMAT_NEON)
+  {
+    const auto min = vdupq_n_f32(-1.f);
+    const auto max = vdupq_n_f32(1.f);
+    const auto offset = vdupq_n_s32(uint8Offset);
+    for(; i + 8 <= count; i += 8) {
+      const auto a = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), min), max), uint8Scale);
+      const auto b = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), min), max), uint8Scale);
+      const auto lo = vqmovun_s32(vaddq_s32(vcvtnq_s32_f32(a), offset));
+      const auto hi = vqmovun_s32(vaddq_s32(vcvtnq_s32_f32(b), offset));
+      vst1_u8(dst + i, vqmovn_u16(vcombine_u16(lo, hi)));
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    dst[i] = toUint8(src[i]);
+  }
+}
+
+} // namespace audio
@@ -0,0 +1,45 @@
+#ifndef AUDIO_FORMAT_H
+#define AUDIO_FORMAT_H
+
+#include "AudioSequence.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+/// batch conversion between sample formats;
+/// integer samples map to [-1, 1) in float, float samples are clamped and rounded
+/// @note  uses SSE2/AVX2/NEON as enabled for the build, scalar code otherwise
+void convert(const int16_t* src, size_t count, float* dst);
+void convert(const int32_t* src, size_t count, float* dst);
+void convert(const uint8_t* src, size_t count, float* dst);
+void convert(const float* src, size_t count, int16_t* dst);
+void convert(const float* src, size_t count, int32_t* dst);
+void convert(const float* src, size_t count, uint8_t* dst);
+
+template<typename T>
+void convert(const T* src, size_t count, T* dst)
+{
+  (void)std::copy(src, src + count, dst);
+}
+
+/// convert a whole sequence group by group, e.g. a compact int16_t recording to float for processing
+template<typename To, typename From>
+Sequence<To> convert(const Sequence<From>& seq)
+{
+  Sequence<To> ret{seq.metadata, {}, {}};
+  for(size_t group = 0; group < seq.groupCount(); ++group) {
+    const auto pinned = seq.pinGroup(group);
+    auto&& samples = *pinned;
+    typename Sequence<To>::Samples converted(samples.size());
+    convert(samples.data(), samples.size(), converted.data());
+    ret.push(std::move(converted));
+  }
+  return ret;
+}
+
+} // namespace audio
+
+#endif // AUDIO_FORMAT_H
@@ -0,0 +1,332 @@
+#include "AudioGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_GENERATOR_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  const size_t laneCount = 4;
+
+  // samples after which the oscillator phasor is recomputed from the double phase
+  const size_t resyncInterval = 1024;
+
+  // samples of chirp phase evaluated per polynomial batch
+  const size_t chirpBatchSize = 64;
+
+  const double twoPi = 2 * M_PI;
+  const float pi = static_cast<float>(M_PI);
+  const float halfPi = static_cast<float>(M_PI / 2);
+
+  // odd Taylor coefficients of sin, sufficient for float precision within [-pi/2, pi/2]
+  const float sin3 = -1.f / 6;
+  const float sin5 = 1.f / 120;
+  const float sin7 = -1.f / 5040;
+  const float sin9 = 1.f / 362880;
+  const float sin11 = -1.f / 39916800;
+
+  /// sin of x within [-pi, pi]
+  inline float sinPoly(float x)
+  {
+    // mirror into [-pi/2, pi/2]
+    if(x > halfPi) {
+      x = pi - x;
+    } else if(x < -halfPi) {
+      x = -pi - x;
+    }
+    const auto x2 = x * x;
+    return x * (1 + x2 * (sin3 + x2 * (sin5 + x2 * (sin7 + x2 * (sin9 + x2 * sin11)))));
+  }
+
+  /// dst = amplitude * sin(2pi * phase) (or added to dst) for phases [cycles] within [-0.5, 0.5]
+  template<bool isMixing>
+  void sinCycles(const float* phase, size_t count, float amplitude, float* dst)
+  {
+    size_t i = 0;
+#if defined(AUDIO_GENERATOR_SSE2)
+    {
+      const auto scale = _mm_set1_ps(2 * pi);
+      const auto piV = _mm_set1_ps(pi);
+      const auto halfPiV = _mm_set1_ps(halfPi);
+      const auto amplitudeV = _mm_set1_ps(amplitude);
+      for(; i + laneCount <= count; i += laneCount) {
+        auto x = _mm_mul_ps(_mm_loadu_ps(phase + i), scale);
+
+        // mirror into [-pi/2, pi/2]: pi - x above, -pi - x below
+        const auto isAbove = _mm_cmpgt_ps(x, halfPiV);
+        const auto isBelow = _mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), halfPiV));
+        const auto mirrored = _mm_sub_ps(
+              _mm_or_ps(_mm_and_ps(isAbove, piV), _mm_and_ps(isBelow, _mm_sub_ps(_mm_setzero_ps(), piV))),
+              x);
+        const auto isMirrored = _mm_or_ps(isAbove, isBelow);
+        x = _mm_or_ps(_mm_and_ps(isMirrored, mirrored), _mm_andnot_ps(isMirrored, x));
+
+        const auto x2 = _mm_mul_ps(x, x);
+        auto p = _mm_add_ps(_mm_set1_ps(sin9), _mm_mul_ps(x2, _mm_set1_ps(sin11)));
+        p = _mm_add_ps(_mm_set1_ps(sin7), _mm_mul_ps(x2, p));
+        p = _mm_add_ps(_mm_set1_ps(sin5), _mm_mul_ps(x2, p));
+        p = _mm_add_ps(_mm_set1_ps(sin3), _mm_mul_ps(x2, p));
+        p = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(x2, p));
+        auto y = _mm_mul_ps(amplitudeV, _mm_mul_ps(x, p));
+
+        if(isMixing) {
+          y = _mm_add_ps(y, _mm_loadu_ps(dst + i));
+        }
+        _mm_storeu_ps(dst + i, y);
+      }
+    }
+#endif
+#if defined(AUDIO_GENERATOR_NEON)
+    {
+      const auto piV = vdupq_n_f32(pi);
+      const auto negPiV = vdupq_n_f32(-pi);
+      const auto halfPiV = vdupq_n_f32(halfPi);
+      const auto negHalfPiV = vdupq_n_f32(-halfPi);
+      for(; i + laneCount <= count; i += laneCount) {
+        auto x = vmulq_n_f32(vld1q_f32(phase + i), 2 * pi);
+
+        // mirror into [-pi/2, pi/2]: pi - x above, -pi - x below
+        x = vbslq_f32(vcgtq_f32(x, halfPiV), vsubq_f32(piV, x), x);
+        x = vbslq_f32(vcltq_f32(x, negHalfPiV), vsubq_f32(negPiV, x), x);
+
+        const auto x2 = vmulq_f32(x, x);
+        auto p = vmlaq_n_f32(vdupq_n_f32(sin9), x2, sin11);
+        p = vmlaq_f32(vdupq_n_f32(sin7), x2, p);
+        p = vmlaq_f32(vdupq_n_f32(sin5), x2, p);
+        p = vmlaq_f32(vdupq_n_f32(sin3), x2, p);
+        p = vmlaq_f32(vdupq_n_f32(1.f), x2, p);
+        auto y = vmulq_n_f32(vmulq_f32(x, p), amplitude);
+
+        if(isMixing) {
+          y = vaddq_f32(y, vld1q_f32(dst + i));
+        }
+        vst1q_f32(dst + i, y);
+      }
+    }
+#endif
+    for(; i < count; ++i) {
+      const auto y = amplitude * sinPoly(2 * pi * phase[i]);
+      dst[i] = (isMixing ? dst[i] + y : y);
+    }
+  }
+} // namespace
+
+Oscillator::Oscillator(int sampleRate, double frequency, float amplitude, double phase)
+  : sampleRate_(sampleRate)
+  , amplitude_(amplitude)
+  , phase_(std::fmod(phase, twoPi))
+{
+  if(sampleRate <= 0) {
+    throw std::runtime_error("Invalid oscillator sample rate");
+  }
+  setFrequency(frequency);
+}
+
+void Oscillator::setFrequency(double frequency)
+{
+  frequency_ = frequency;
+  increment_ = twoPi * frequency / sampleRate_;
+  rotationCos_ = static_cast<float>(std::cos(laneCount * increment_));
+  rotationSin_ = static_cast<float>(std::sin(laneCount * increment_));
+}
+
+double Oscillator::frequency() const
+{
+  return frequency_;
+}
+
+void Oscillator::setAmplitude(float amplitude)
+{
+  amplitude_ = amplitude;
+}
+
+void Oscillator::generate(float* dst, size_t count)
+{
+  render<false>(dst, count);
+}
+
+void Oscillator::mix(float* dst, size_t count)
+{
+  render<true>(dst, count);
+}
+
+template<bool isMixing>
+void Oscillator::render(float* dst, size_t count)
+{
+  for(size_t done = 0; done < count;) {
+    const auto chunk = std::min(resyncInterval, count - done);
+
+    // phasors of four consecutive samples, exact from the double phase
+    alignas(16) float re[laneCount];
+    alignas(16) float im[laneCount];
+    for(size_t k = 0; k < laneCount; ++k) {
+      re[k] = static_cast<float>(std::cos(phase_ + static_cast<double>(k) * increment_));
+      im[k] = static_cast<float>(std::sin(phase_ + static_cast<double>(k) * increment_));
+    }
+
+    auto out = dst + done;
+    size_t i = 0;
+#if defined(AUDIO_GENERATOR_SSE2)
+    {
+      auto reV = _mm_load_ps(re);
+      auto imV = _mm_load_ps(im);
+      const auto c = _mm_set1_ps(rotationCos_);
+      const auto s = _mm_set1_ps(rotationSin_);
+      const auto amplitude = _mm_set1_ps(amplitude_);
+      for(; i + laneCount <= chunk; i += laneCount) {
+        auto y = _mm_mul_ps(imV, amplitude);
+        if(isMixing) {
+          y = _mm_add_ps(y, _mm_loadu_ps(out + i));
+        }
+        _mm_storeu_ps(out + i, y);
+
+        const auto nextRe = _mm_sub_ps(_mm_mul_ps(reV, c), _mm_mul_ps(imV, s));
+        imV = _mm_add_ps(_mm_mul_ps(reV, s), _mm_mul_ps(imV, c));
+        reV = nextRe;
+      }
+      _mm_store_ps(re, reV);
+      _mm_store_ps(im, imV);
+    }
+#endif
+#if defined(AUDIO_GENERATOR_NEON)
+    {
+      auto reV = vld1q_f32(re);
+      auto imV = vld1q_f32(im);
+      for(; i + laneCount <= chunk; i += laneCount) {
+        auto y = vmulq_n_f32(imV, amplitude_);
+        if(isMixing) {
+          y = vaddq_f32(y, vld1q_f32(out + i));
+        }
+        vst1q_f32(out + i, y);
+
+        const auto nextRe = vmlsq_n_f32(vmulq_n_f32(reV, rotationCos_), imV, rotationSin_);
+        imV = vmlaq_n_f32(vmulq_n_f32(imV, rotationCos_), reV, rotationSin_);
+        reV = nextRe;
+      }
+      vst1q_f32(re, reV);
+      vst1q_f32(im, imV);
+    }
+#endif
+    for(; i < chunk; i += laneCount) {
+      for(size_t k = 0; k < laneCount && i + k < chunk; ++k) {
+        const auto y = amplitude_ * im[k];
+        out[i + k] = (isMixing ? out[i + k] + y : y);
+      }
+      for(size_t k = 0; k < laneCount; ++k) {
+        const auto nextRe = re[k] * rotationCos_ - im[k] * rotationSin_;
+        im[k] = re[k] * rotationSin_ + im[k] * rotationCos_;
+        re[k] = nextRe;
+      }
+    }
+
+    phase_ = std::fmod(phase_ + static_cast<double>(chunk) * increment_, twoPi);
+    if(phase_ < 0.0) {
+      phase_ += twoPi;
+    }
+    done += chunk;
+  }
+}
+
+Chirp::Chirp(
+    int sampleRate,
+    double startFrequency,
+    double endFrequency,
+    std::chrono::duration<double> length,
+    ChirpShape shape,
+    float amplitude)
+  : shape_(shape)
+  , amplitude_(amplitude)
+  , size_(static_cast<size_t>(length.count() * sampleRate))
+  , position_(0)
+  , phase_(0.0)
+  , increment_(startFrequency / sampleRate)
+{
+  if(sampleRate <= 0 || size_ == 0) {
+    throw std::runtime_error("Invalid chirp settings");
+  }
+  if(shape == ChirpShape::Exponential && (startFrequency <= 0.0 || endFrequency <= 0.0)) {
+    throw std::runtime_error("Exponential chirp requires positive frequencies");
+  }
+
+  if(shape == ChirpShape::Linear) {
+    incrementStep_ = (endFrequency - startFrequency) / sampleRate / static_cast<double>(size_);
+  } else {
+    incrementStep_ = std::pow(endFrequency / startFrequency, 1.0 / static_cast<double>(size_));
+  }
+}
+
+size_t Chirp::size() const
+{
+  return size_;
+}
+
+void Chirp::generate(float* dst, size_t count)
+{
+  render<false>(dst, count);
+}
+
+void Chirp::mix(float* dst, size_t count)
+{
+  render<true>(dst, count);
+}
+
+template<bool isMixing>
+void Chirp::render(float* dst, size_t count)
+{
+  float phases[chirpBatchSize];
+  for(size_t done = 0; done < count;) {
+    const auto batch = std::min(chirpBatchSize, count - done);
+
+    for(size_t i = 0; i < batch; ++i) {
+      phases[i] = static_cast<float>(phase_);
+
+      phase_ += increment_;
+      if(phase_ >= 0.5) {
+        phase_ -= 1.0;
+      } else if(phase_ < -0.5) {
+        phase_ += 1.0;
+      }
+
+      if(position_ < size_) {
+        increment_ = (shape_ == ChirpShape::Linear ? increment_ + incrementStep_ : increment_ * incrementStep_);
+        ++position_;
+      }
+    }
+    sinCycles<isMixing>(phases, batch, amplitude_, dst + done);
+
+    done += batch;
+  }
+}
+
+Multitone::Multitone(int sampleRate, const std::vector<double>& frequencies, float amplitude)
+{
+  tones_.reserve(frequencies.size());
+  for(auto&& frequency : frequencies) {
+    tones_.emplace_back(sampleRate, frequency, amplitude);
+  }
+}
+
+void Multitone::generate(float* dst, size_t count)
+{
+  std::fill(dst, dst + count, 0.f);
+  mix(dst, count);
+}
+
+void Multitone::mix(float* dst, size_t count)
+{
+  for(auto&& tone : tones_) {
+    tone.mix(dst, count);
+  }
+}
+
+} // namespace audio
@@ -0,0 +1,126 @@
+#ifndef AUDIO_GENERATOR_H
+#define AUDIO_GENERATOR_H
+
+#include "AudioSequence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace audio {
+
+/// sine oscillator rotating a quadrature phasor, four samples at a time;
+/// the phase is kept in double precision and the phasor resynchronized to it regularly
+/// @note  uses SSE2/NEON as enabled for the build
+struct Oscillator
+{
+  Oscillator(int sampleRate, double frequency, float amplitude = 1.f, double phase = 0.0);
+
+  /// change the frequency [Hz] while keeping the phase continuous
+  void setFrequency(double frequency);
+  double frequency() const;
+
+  void setAmplitude(float amplitude);
+
+  /// write the next count samples to dst
+  void generate(float* dst, size_t count);
+
+  /// add the next count samples to dst
+  void mix(float* dst, size_t count);
+
+private:
+  template<bool isMixing>
+  void render(float* dst, size_t count);
+
+private:
+  int sampleRate_;
+  double frequency_; // [Hz]
+  float amplitude_;
+  double phase_; // [rad], wrapped to [0, 2pi)
+  double increment_; // [rad] per sample
+  float rotationCos_; ///< rotation by four samples
+  float rotationSin_;
+};
+
+enum class ChirpShape
+{
+  Linear, ///< frequency changes by a constant amount per second
+  Exponential ///< frequency changes by a constant factor per second, i.e. constant octaves per second
+};
+
+/// sine of continuously changing frequency, holding the end frequency once the length elapsed;
+/// the phase is accumulated in double precision, wrapped and evaluated by a polynomial
+/// @note  uses SSE2/NEON as enabled for the build
+struct Chirp
+{
+  Chirp(int sampleRate,
+        double startFrequency,
+        double endFrequency,
+        std::chrono::duration<double> length,
+        ChirpShape shape = ChirpShape::Exponential,
+        float amplitude = 1.f);
+
+  /// number of samples until the end frequency is reached
+  size_t size() const;
+
+  /// write the next count samples to dst
+  void generate(float* dst, size_t count);
+
+  /// add the next count samples to dst
+  void mix(float* dst, size_t count);
+
+private:
+  template<bool isMixing>
+  void render(float* dst, size_t count);
+
+private:
+  ChirpShape shape_;
+  float amplitude_;
+  size_t size_;
+  size_t position_;
+  double phase_; // [cycles], wrapped to [-0.5, 0.5)
+  double increment_; // [cycles] per sample
+  double incrementStep_; ///< added (linear) or multiplied (exponential) per sample
+};
+
+/// sum of sine oscillators
+struct Multitone
+{
+  /// @param amplitude  of each single tone
+  Multitone(int sampleRate, const std::vector<double>& frequencies, float amplitude = 1.f);
+
+  /// write the next count samples to dst
+  void generate(float* dst, size_t count);
+
+  /// add the next count samples to dst
+  void mix(float* dst, size_t count);
+
+private:
+  std::vector<Oscillator> tones_;
+};
+
+/// sequence of frameCount samples per channel, each channel holding the same generated signal
+template<typename Generator>
+Sequence<float> generate(const Metadata& metadata, Generator& generator, size_t frameCount)
+{
+  Sequence<float> seq{metadata, {}, {}};
+  for(size_t done = 0; done < frameCount;) {
+    const auto frames = std::min<size_t>(metadata.sampleCount, frameCount - done);
+
+    typename Sequence<float>::Samples values(frames * metadata.channelCount);
+    generator.generate(values.data(), frames);
+    for(uint8_t c = 1; c < metadata.channelCount; ++c) {
+      (void)std::copy(std::begin(values), std::begin(values) + static_cast<std::ptrdiff_t>(frames),
+                      std::begin(values) + static_cast<std::ptrdiff_t>(c * frames));
+    }
+    seq.push(std::move(values));
+
+    done += frames;
+  }
+  return seq;
+}
+
+} // namespace audio
+
+#endif // AUDIO_GENERATOR_H
@@ -0,0 +1,202 @@
+#include "AudioPeaks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_PEAKS_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_PEAKS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  inline bool isLocalMaximum(const float* s, float threshold)
+  {
+    return (s[0] > threshold) && (s[0] > s[-1]) && (s[0] >= s[1]);
+  }
+
+  /// append the bins flagged in a 4-bit mask starting at bin
+  inline size_t appendMask(unsigned mask, uint32_t bin, uint32_t* dst, size_t done, size_t maxCount)
+  {
+    for(; mask != 0 && done < maxCount; mask &= mask - 1) {
+      unsigned offset = 0;
+      while(!(mask & (1U << offset))) {
+        ++offset;
+      }
+      dst[done++] = bin + offset;
+    }
+    return done;
+  }
+} // namespace
+
+size_t findLocalMaxima(const float* spectrum, size_t size, float threshold, uint32_t* dst, size_t maxCount)
+{
+  size_t done = 0;
+  size_t i = 1;
+#if defined(AUDIO_PEAKS_SSE2)
+  {
+    const auto thresh = _mm_set1_ps(threshold);
+    for(; i + 5 <= size && done < maxCount; i += 4) {
+      const auto l = _mm_loadu_ps(spectrum + i - 1);
+      const auto c = _mm_loadu_ps(spectrum + i);
+      const auto r = _mm_loadu_ps(spectrum + i + 1);
+      const auto isMax = _mm_and_ps(
+            _mm_and_ps(_mm_cmpgt_ps(c, l), _mm_cmpge_ps(c, r)),
+            _mm_cmpgt_ps(c, thresh));
+      const auto mask = static_cast<unsigned>(_mm_movemask_ps(isMax));
+      done = appendMask(mask, static_cast<uint32_t>(i), dst, done, maxCount);
+    }
+  }
+#endif
+#if defined(AUDIO_PEAKS_NEON)
+  {
+    const auto thresh = vdupq_n_f32(threshold);
+    const uint32_t bits[] = {1, 2, 4, 8};
+    const auto bitMask = vld1q_u32(bits);
+    for(; i + 5 <= size && done < maxCount; i += 4) {
+      const auto l = vld1q_f32(spectrum + i - 1);
+      const auto c = vld1q_f32(spectrum + i);
+      const auto r = vld1q_f32(spectrum + i + 1);
+      const auto isMax = vandq_u32(
+            vandq_u32(vcgtq_f32(c, l), vcgeq_f32(c, r)),
+            vcgtq_f32(c, thresh));
+      const auto mask = vaddvq_u32(vandq_u32(isMax, bitMask));
+      done = appendMask(mask, static_cast<uint32_t>(i), dst, done, maxCount);
+    }
+  }
+#endif
+  for(; i + 1 < size && done < maxCount; ++i) {
+    if(isLocalMaximum(spectrum + i, threshold)) {
+      dst[done++] = static_cast<uint32_t>(i);
+    }
+  }
+  return done;
+}
+
+Peak interpolatePeak(const float* spectrum, uint32_t bin)
+{
+  const auto l = spectrum[bin - 1];
+  const auto c = spectrum[bin];
+  const auto r = spectrum[bin + 1];
+
+  const auto curvature = l - 2 * c + r;
+  if(curvature == 0.f) {
+    return Peak{static_cast<float>(bin), c};
+  }
+
+  // vertex of the parabola; within half a bin as c is a local maximum
+  const auto offset = 0.5f * (l - r) / curvature;
+  return Peak{static_cast<float>(bin) + offset, c - 0.25f * (l - r) * offset};
+}
+
+PeakTracker::PeakTracker(
+    const Metadata& metadata,
+    size_t frameSize,
+    size_t maxPeaks,
+    float dynamicRange,
+    float maxDeviation,
+    uint32_t maxMissed)
+  : binWidth_(static_cast<float>(metadata.sampleRate) / static_cast<float>(frameSize))
+  , maxPeaks_(maxPeaks)
+  , dynamicRange_(dynamicRange)
+  , maxDeviation_(maxDeviation)
+  , maxMissed_(maxMissed)
+  , nextId_(0)
+  , maxima_(frameSize / 2)
+{
+  if(frameSize == 0 || maxPeaks == 0) {
+    throw std::runtime_error("Invalid peak tracker settings");
+  }
+
+  // each frame adds at most maxPeaks tracks, each surviving at most maxMissed unmatched frames
+  const auto maxTracks = maxPeaks * (maxMissed + 1);
+  peaks_.reserve(maxPeaks);
+  isMatched_.reserve(maxTracks);
+  tracks_.reserve(maxTracks);
+}
+
+const std::vector<Track>& PeakTracker::update(const float* spectrum, size_t size)
+{
+  if(size < 3) {
+    return tracks_;
+  }
+
+  // candidates within the dynamic range of the frame, strongest first
+  const auto threshold = *std::max_element(spectrum + 1, spectrum + size - 1) - dynamicRange_;
+  maxima_.resize(maxima_.capacity());
+  maxima_.resize(findLocalMaxima(spectrum, size, threshold, maxima_.data(), maxima_.size()));
+
+  const auto peakCount = std::min(maxPeaks_, maxima_.size());
+  std::partial_sort(
+        std::begin(maxima_), std::begin(maxima_) + static_cast<std::ptrdiff_t>(peakCount), std::end(maxima_),
+        [spectrum](uint32_t lhs, uint32_t rhs) -> bool { return spectrum[lhs] > spectrum[rhs]; });
+
+  peaks_.clear();
+  for(size_t p = 0; p < peakCount; ++p) {
+    peaks_.push_back(interpolatePeak(spectrum, maxima_[p]));
+  }
+
+  // greedily continue the nearest unmatched track, strongest peak first
+  const auto previousTrackCount = tracks_.size();
+  isMatched_.assign(previousTrackCount, false);
+  for(auto&& peak : peaks_) {
+    const auto frequency = peak.bin * binWidth_;
+
+    size_t nearest = previousTrackCount;
+    float nearestDeviation = maxDeviation_;
+    for(size_t t = 0; t < previousTrackCount; ++t) {
+      const auto deviation = std::abs(tracks_[t].frequency - frequency);
+      if(!isMatched_[t] && deviation <= nearestDeviation) {
+        nearest = t;
+        nearestDeviation = deviation;
+      }
+    }
+
+    if(nearest < previousTrackCount) {
+      auto&& track = tracks_[nearest];
+      track.frequency = frequency;
+      track.level = peak.level;
+      ++track.age;
+      track.missed = 0;
+      isMatched_[nearest] = true;
+    } else if(tracks_.size() < tracks_.capacity()) {
+      tracks_.push_back(Track{nextId_++, frequency, peak.level, 1, 0});
+    }
+  }
+
+  // age unmatched tracks and drop the expired ones
+  for(size_t t = 0; t < previousTrackCount; ++t) {
+    if(!isMatched_[t]) {
+      ++tracks_[t].missed;
+    }
+  }
+  tracks_.erase(
+        std::remove_if(
+          std::begin(tracks_), std::end(tracks_),
+          [this](const Track& track) -> bool { return track.missed > maxMissed_; }),
+        std::end(tracks_));
+
+  std::sort(
+        std::begin(tracks_), std::end(tracks_),
+        [](const Track& lhs, const Track& rhs) -> bool { return lhs.level > rhs.level; });
+
+  return tracks_;
+}
+
+const std::vector<Track>& PeakTracker::update(const std::vector<float>& spectrum)
+{
+  return update(spectrum.data(), spectrum.size());
+}
+
+const std::vector<Track>& PeakTracker::tracks() const
+{
+  return tracks_;
+}
+
+} // namespace audio
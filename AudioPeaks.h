@@ -0,0 +1,78 @@
+#ifndef AUDIO_PEAKS_H
+#define AUDIO_PEAKS_H
+
+#include "AudioSequence.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/// spectral peak with sub-bin precision
+struct Peak
+{
+  float bin; ///< interpolated position [bins]
+  float level; ///< interpolated height, in the unit of the spectrum
+};
+
+/// find bins above threshold and above both neighbours (or plateau starts)
+/// within spectrum[1, size - 1)
+/// @return  number of bin indices written to dst, at most maxCount
+/// @note  uses SSE2/NEON as enabled for the build
+size_t findLocalMaxima(const float* spectrum, size_t size, float threshold, uint32_t* dst, size_t maxCount);
+
+/// fit a parabola through a local maximum and its neighbours;
+/// most accurate on logarithmic spectra
+Peak interpolatePeak(const float* spectrum, uint32_t bin);
+
+/// partial followed across spectrum frames
+struct Track
+{
+  uint32_t id; ///< unique among all tracks of a tracker
+  float frequency; // [Hz]
+  float level; ///< in the unit of the spectrum
+  uint32_t age; ///< number of frames the track was matched in
+  uint32_t missed; ///< number of consecutive frames the track was not matched in
+};
+
+/// incremental peak tracking over consecutive (decibel) spectrum frames,
+/// matching each frame's strongest peaks to the nearest tracks of the previous frames
+/// @note  no allocation happens after construction
+struct PeakTracker
+{
+  /// @param frameSize  transform size the spectra of frameSize / 2 + 1 bins were computed with
+  /// @param maxPeaks  maximum number of peaks considered per frame
+  /// @param dynamicRange  ignore peaks further below the frame's maximum [dB]
+  /// @param maxDeviation  maximum frequency change of a track between frames [Hz]
+  /// @param maxMissed  number of frames a track survives without a matching peak
+  PeakTracker(const Metadata& metadata,
+              size_t frameSize,
+              size_t maxPeaks = 16,
+              float dynamicRange = 30.f,
+              float maxDeviation = 20.f,
+              uint32_t maxMissed = 2);
+
+  /// match the peaks of the next spectrum frame
+  /// @return  tracks alive after this frame, strongest first
+  const std::vector<Track>& update(const float* spectrum, size_t size);
+  const std::vector<Track>& update(const std::vector<float>& spectrum);
+
+  const std::vector<Track>& tracks() const;
+
+private:
+  float binWidth_; // [Hz]
+  size_t maxPeaks_;
+  float dynamicRange_;
+  float maxDeviation_;
+  uint32_t maxMissed_;
+  uint32_t nextId_;
+  std::vector<uint32_t> maxima_; ///< candidate bins of the current frame
+  std::vector<Peak> peaks_; ///< strongest peaks of the current frame
+  std::vector<bool> isMatched_; ///< per track of the previous frame
+  std::vector<Track> tracks_;
+};
+
+} // namespace audio
+
+#endif // AUDIO_PEAKS_H
@@ -0,0 +1,341 @@
+#include "AudioResampler.h"
+#include "AudioChannels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_RESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  const size_t laneCount = 4;
+
+  // Kaiser window for about 80dB stopband attenuation
+  const double kaiserBeta = 7.86;
+  // transition band width [fraction of the sampling rate] times the number of taps
+  const double kaiserTransitionTaps = 5.0;
+
+  int greatestCommonDivisor(int a, int b)
+  {
+    while(b != 0) {
+      const auto r = a % b;
+      a = b;
+      b = r;
+    }
+    return a;
+  }
+
+  /// modified Bessel function of the first kind of order 0
+  double besselI0(double x)
+  {
+    double sum = 1.0;
+    double term = 1.0;
+    for(int k = 1; term > 1e-12 * sum; ++k) {
+      const auto t = x / (2.0 * k);
+      term *= t * t;
+      sum += term;
+    }
+    return sum;
+  }
+
+  double sinc(double x)
+  {
+    return (x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x));
+  }
+
+  /// dot products of samples with two coefficient rows of count (a multiple of laneCount) taps
+  inline void dot2(const float* samples, const float* a, const float* b, size_t count, float& dotA, float& dotB)
+  {
+    size_t i = 0;
+    dotA = 0.f;
+    dotB = 0.f;
+#if defined(AUDIO_RESAMPLER_SSE2)
+    {
+      auto sumA = _mm_setzero_ps();
+      auto sumB = _mm_setzero_ps();
+      for(; i + laneCount <= count; i += laneCount) {
+        const auto x = _mm_loadu_ps(samples + i);
+        sumA = _mm_add_ps(sumA, _mm_mul_ps(x, _mm_loadu_ps(a + i)));
+        sumB = _mm_add_ps(sumB, _mm_mul_ps(x, _mm_loadu_ps(b + i)));
+      }
+      alignas(16) float lanesA[laneCount];
+      alignas(16) float lanesB[laneCount];
+      _mm_store_ps(lanesA, sumA);
+      _mm_store_ps(lanesB, sumB);
+      dotA = (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+      dotB = (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+    }
+#endif
+#if defined(AUDIO_RESAMPLER_NEON)
+    {
+      auto sumA = vdupq_n_f32(0.f);
+      auto sumB = vdupq_n_f32(0.f);
+      for(; i + laneCount <= count; i += laneCount) {
+        const auto x = vld1q_f32(samples + i);
+        sumA = vmlaq_f32(sumA, x, vld1q_f32(a + i));
+        sumB = vmlaq_f32(sumB, x, vld1q_f32(b + i));
+      }
+      dotA = vaddvq_f32(sumA);
+      dotB = vaddvq_f32(sumB);
+    }
+#endif
+    for(; i < count; ++i) {
+      dotA += samples[i] * a[i];
+      dotB += samples[i] * b[i];
+    }
+  }
+} // namespace
+
+Resampler::Resampler(int inputRate, int outputRate, uint8_t channelCount, size_t tapCount, size_t phaseCount)
+  : inputRate_(inputRate)
+  , outputRate_(outputRate)
+  , channelCount_(channelCount)
+  , tapCount_(0)
+  , phaseCount_(phaseCount)
+  , capacity_(0)
+  , frameCount_(0)
+  , position_(0)
+  , remainder_(0)
+{
+  if(inputRate <= 0 || outputRate <= 0 || channelCount == 0 || phaseCount == 0) {
+    throw std::runtime_error("Invalid resampler settings");
+  }
+
+  // output positions advance in exact integer steps of the reduced ratio
+  const auto divisor = greatestCommonDivisor(inputRate, outputRate);
+  inputRate_ /= divisor;
+  outputRate_ /= divisor;
+
+  // when downsampling, the filter spans tapCount frames of the output rate
+  const auto stretch = std::max(1.0, static_cast<double>(inputRate) / outputRate);
+  const auto taps = static_cast<size_t>(std::ceil(static_cast<double>(tapCount) * stretch));
+  tapCount_ = std::max(laneCount, (taps + laneCount - 1) / laneCount * laneCount);
+
+  // the stopband starts at the lower of both Nyquist frequencies [fraction of the input rate]
+  const auto half = tapCount_ / 2;
+  const auto nyquist = 0.5 * std::min(1.0, static_cast<double>(outputRate) / inputRate);
+  const auto cutoff = std::max(0.5 * nyquist, nyquist - 0.5 * kaiserTransitionTaps / static_cast<double>(tapCount_));
+
+  // row p holds the taps for an output position p / phaseCount past a frame,
+  // tap k weighting the frame at distance p / phaseCount + half - 1 - k
+  coefficients_.resize((phaseCount_ + 1) * tapCount_);
+  const auto windowScale = 1.0 / besselI0(kaiserBeta);
+  for(size_t p = 0; p <= phaseCount_; ++p) {
+    const auto row = coefficients_.data() + p * tapCount_;
+    const auto offset = static_cast<double>(p) / static_cast<double>(phaseCount_) + static_cast<double>(half) - 1.0;
+
+    std::vector<double> weights(tapCount_);
+    double sum = 0.0;
+    for(size_t k = 0; k < tapCount_; ++k) {
+      const auto distance = offset - static_cast<double>(k);
+      const auto x = distance / static_cast<double>(half);
+      const auto window = besselI0(kaiserBeta * std::sqrt(std::max(0.0, 1.0 - x * x))) * windowScale;
+      weights[k] = 2.0 * cutoff * sinc(2.0 * cutoff * distance) * window;
+      sum += weights[k];
+    }
+    for(size_t k = 0; k < tapCount_; ++k) {
+      row[k] = static_cast<float>(weights[k] / sum);
+    }
+  }
+
+  reset();
+}
+
+size_t Resampler::maxOutputFrames(size_t inputFrameCount) const
+{
+  const auto in = static_cast<uint64_t>(inputRate_);
+  return static_cast<size_t>((inputFrameCount * static_cast<uint64_t>(outputRate_) + in - 1) / in + 1);
+}
+
+size_t Resampler::maxFlushFrames() const
+{
+  return maxOutputFrames(tapCount_ / 2);
+}
+
+size_t Resampler::process(const float* input, size_t frameCount, float* output)
+{
+  reserve(frameCount);
+  deinterleave(input, frameCount, channelCount_, history_.data() + frameCount_, capacity_);
+  frameCount_ += frameCount;
+  return render(output);
+}
+
+size_t Resampler::flush(float* output)
+{
+  // silence after the end completes the windows of all output positions before the end
+  const auto half = tapCount_ / 2;
+  reserve(half);
+  for(size_t c = 0; c < channelCount_; ++c) {
+    const auto plane = history_.data() + c * capacity_;
+    std::fill(plane + frameCount_, plane + frameCount_ + half, 0.f);
+  }
+  frameCount_ += half;
+
+  const auto done = render(output);
+  reset();
+  return done;
+}
+
+void Resampler::reserve(size_t frameCount)
+{
+  const auto capacity = tapCount_ + frameCount;
+  if(capacity <= capacity_) {
+    return;
+  }
+
+  std::vector<float> history(capacity * channelCount_);
+  for(size_t c = 0; c < channelCount_; ++c) {
+    const auto plane = history_.data() + c * capacity_;
+    (void)std::copy(plane, plane + frameCount_, history.data() + c * capacity);
+  }
+  history_ = std::move(history);
+  capacity_ = capacity;
+}
+
+void Resampler::reset()
+{
+  // the first output position is preceded by half a window of silence
+  const auto half = tapCount_ / 2;
+  reserve(0);
+  std::fill(std::begin(history_), std::end(history_), 0.f);
+  frameCount_ = half - 1;
+  position_ = half - 1;
+  remainder_ = 0;
+}
+
+size_t Resampler::render(float* output)
+{
+  const auto half = tapCount_ / 2;
+  const auto inputRate = static_cast<uint64_t>(inputRate_);
+  const auto outputRate = static_cast<uint64_t>(outputRate_);
+
+  size_t done = 0;
+  while(position_ + half < frameCount_) {
+    // interpolate between the two tabulated phases around the exact position
+    const auto phase = static_cast<double>(remainder_ * phaseCount_) / static_cast<double>(outputRate);
+    const auto row = std::min(static_cast<size_t>(phase), phaseCount_ - 1);
+    const auto fraction = static_cast<float>(phase - static_cast<double>(row));
+    const auto a = coefficients_.data() + row * tapCount_;
+    const auto b = a + tapCount_;
+
+    const auto first = position_ + 1 - half;
+    for(size_t c = 0; c < channelCount_; ++c) {
+      float dotA;
+      float dotB;
+      dot2(history_.data() + c * capacity_ + first, a, b, tapCount_, dotA, dotB);
+      output[done * channelCount_ + c] = dotA + fraction * (dotB - dotA);
+    }
+    ++done;
+
+    remainder_ += inputRate;
+    position_ += static_cast<size_t>(remainder_ / outputRate);
+    remainder_ %= outputRate;
+  }
+
+  // keep the frames the next window starts with
+  const auto drop = std::min(position_ + 1 - half, frameCount_);
+  if(drop > 0) {
+    for(size_t c = 0; c < channelCount_; ++c) {
+      const auto plane = history_.data() + c * capacity_;
+      (void)std::copy(plane + drop, plane + frameCount_, plane);
+    }
+    frameCount_ -= drop;
+    position_ -= drop;
+  }
+  return done;
+}
+
+
+Sequence<float> resample(const Sequence<float>& seq, int sampleRate)
+{
+  const auto& metadata = seq.metadata;
+  const size_t channelCount = metadata.channelCount;
+  Resampler resampler(metadata.sampleRate, sampleRate, metadata.channelCount);
+
+  auto resampledMetadata = metadata;
+  resampledMetadata.sampleRate = sampleRate;
+  Sequence<float> ret{resampledMetadata, {}, {}};
+
+  // output is collected interleaved and split into capture groups of the original size
+  std::vector<float> interleaved(metadata.groupSize());
+  std::vector<float> output((resampler.maxOutputFrames(metadata.sampleCount) + resampler.maxFlushFrames()) * channelCount);
+  std::vector<float> pending;
+  const auto emit = [&](size_t frameCount, bool isLast) {
+    (void)pending.insert(std::end(pending), std::begin(output), std::begin(output) + static_cast<std::ptrdiff_t>(frameCount * channelCount));
+    size_t first = 0;
+    for(; first + metadata.groupSize() <= pending.size() || (isLast && first < pending.size()); first += metadata.groupSize()) {
+      const auto count = std::min(metadata.groupSize(), pending.size() - first);
+      ret.push(reinterpret_cast<const uint8_t*>(pending.data() + first), static_cast<int>(count * sizeof(float)));
+    }
+    (void)pending.erase(std::begin(pending), std::begin(pending) + static_cast<std::ptrdiff_t>(std::min(first, pending.size())));
+  };
+
+  for(size_t g = 0; g < seq.groupCount(); ++g) {
+    const auto pinned = seq.pinGroup(g);
+    auto&& group = *pinned;
+    const auto frameCount = group.size() / channelCount;
+    interleave(group.data(), frameCount, frameCount, channelCount, interleaved.data());
+    emit(resampler.process(interleaved.data(), frameCount, output.data()), false);
+  }
+  emit(resampler.flush(output.data()), true);
+  return ret;
+}
+
+
+ResampleSource::ResampleSource(std::unique_ptr<Source<float>> upstream, const Metadata& metadata, int sampleRate)
+  : upstream_(std::move(upstream))
+  , channelCount_(metadata.channelCount)
+  , resampler_(metadata.sampleRate, sampleRate, metadata.channelCount)
+  , input_(metadata.groupSize())
+  , output_((resampler_.maxOutputFrames(metadata.sampleCount) + resampler_.maxFlushFrames()) * metadata.channelCount)
+  , outputFirst_(0)
+  , outputLast_(0)
+  , isExhausted_(false)
+{
+  resampler_.reserve(metadata.sampleCount);
+}
+
+size_t ResampleSource::read(float* samples, size_t count)
+{
+  // whole frames only
+  count -= count % channelCount_;
+
+  size_t done = 0;
+  while(done < count) {
+    if(outputFirst_ == outputLast_) {
+      if(isExhausted_) {
+        break;
+      }
+
+      const auto n = upstream_->read(input_.data(), input_.size());
+      outputFirst_ = 0;
+      outputLast_ = resampler_.process(input_.data(), n / channelCount_, output_.data()) * channelCount_;
+      if(n < input_.size()) {
+        outputLast_ += resampler_.flush(output_.data() + outputLast_) * channelCount_;
+        isExhausted_ = true;
+      }
+    }
+
+    const auto n = std::min(count - done, outputLast_ - outputFirst_);
+    (void)std::copy(output_.data() + outputFirst_, output_.data() + outputFirst_ + n, samples + done);
+    outputFirst_ += n;
+    done += n;
+  }
+  return done;
+}
+
+std::unique_ptr<Source<float>> resample(std::unique_ptr<Source<float>> upstream, const Metadata& metadata, int sampleRate)
+{
+  return std::unique_ptr<Source<float>>(new ResampleSource(std::move(upstream), metadata, sampleRate));
+}
+
+} // namespace audio
@@ -0,0 +1,97 @@
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include "AudioSequence.h"
+#include "AudioSource.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace audio {
+
+/// sample rate converter for arbitrary ratios on interleaved float streams, using a polyphase
+/// windowed-sinc filter whose coefficients are tabulated once for a set of fractional positions;
+/// the filter history persists between calls, so consecutive blocks join seamlessly
+/// @note  the filter runs across taps with SSE2/NEON as enabled for the build
+struct Resampler
+{
+  /// @param tapCount  filter length [frames at the lower of both rates]; longer filters cut off sharper
+  /// @param phaseCount  number of tabulated fractional positions; positions in between are interpolated
+  Resampler(int inputRate,
+            int outputRate,
+            uint8_t channelCount,
+            size_t tapCount = 64,
+            size_t phaseCount = 256);
+
+  /// upper bound of the number of frames process() emits for the given number of input frames
+  size_t maxOutputFrames(size_t inputFrameCount) const;
+
+  /// upper bound of the number of frames flush() emits
+  size_t maxFlushFrames() const;
+
+  /// consume interleaved input frames, writing all output frames they complete;
+  /// output frames are held back by half the filter length until enough input arrived
+  /// @param output  space for at least maxOutputFrames(frameCount) frames
+  /// @return  number of frames written
+  /// @note  does not allocate unless frameCount exceeds what was reserved
+  size_t process(const float* input, size_t frameCount, float* output);
+
+  /// end the stream: write the output frames still held back, then restart from silence
+  /// @param output  space for at least maxFlushFrames() frames
+  /// @return  number of frames written
+  size_t flush(float* output);
+
+  /// preallocate for input blocks of up to the given number of frames
+  void reserve(size_t frameCount);
+
+  /// discard the filter history and restart from silence
+  void reset();
+
+private:
+  /// emit all output frames whose filter window is buffered
+  size_t render(float* output);
+
+private:
+  int inputRate_; ///< reduced by the greatest common divisor with the output rate
+  int outputRate_;
+  size_t channelCount_;
+  size_t tapCount_;
+  size_t phaseCount_;
+  std::vector<float> coefficients_; ///< phaseCount + 1 rows of tapCount taps, rows normalized to unit gain
+  std::vector<float> history_; ///< one plane per channel of capacity_ frames each
+  size_t capacity_; // [frames]
+  size_t frameCount_; ///< buffered frames per plane
+  size_t position_; ///< buffered frame at or before the next output position
+  uint64_t remainder_; ///< fraction of the next output position past position_, in 1 / outputRate_
+};
+
+/// resample a whole sequence to another rate; the result is aligned with the input,
+/// i.e. without the delay of the streaming filter
+Sequence<float> resample(const Sequence<float>& seq, int sampleRate);
+
+/// samples of an upstream source resampled on demand, e.g. to play a 44.1kHz recording on a 48kHz device
+struct ResampleSource : Source<float>
+{
+  /// @param metadata  layout of the upstream samples
+  ResampleSource(std::unique_ptr<Source<float>> upstream, const Metadata& metadata, int sampleRate);
+
+  size_t read(float* samples, size_t count) override;
+
+private:
+  std::unique_ptr<Source<float>> upstream_;
+  size_t channelCount_;
+  Resampler resampler_;
+  std::vector<float> input_; ///< one capture group read from upstream
+  std::vector<float> output_; ///< resampled frames not yet read
+  size_t outputFirst_; // [samples]
+  size_t outputLast_; // [samples]
+  bool isExhausted_;
+};
+
+std::unique_ptr<Source<float>> resample(std::unique_ptr<Source<float>> upstream, const Metadata& metadata, int sampleRate);
+
+} // namespace audio
+
+#endif // AUDIO_RESAMPLER_H
@@ -0,0 +1,54 @@
+#ifndef AUDIO_RING_BUFFER_H
+#define AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace audio {
+
+/// wait-free single-producer/single-consumer ring buffer of samples
+template<typename T>
+struct RingBuffer
+{
+  RingBuffer();
+  RingBuffer(size_t capacity);
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer(RingBuffer&&) = delete;
+
+  /// (re-)allocate for at least the given capacity and discard all content;
+  /// not safe while producer or consumer are running
+  void reset(size_t capacity);
+
+  /// append samples (producer only)
+  /// @return  number of samples written, less than count if the buffer is full
+  size_t write(const T* samples, size_t count);
+
+  /// remove samples from the front (consumer only)
+  /// @return  number of samples read, less than count if the buffer runs empty
+  size_t read(T* samples, size_t count);
+
+  /// discard samples from the front (consumer only)
+  /// @return  number of samples skipped
+  size_t skip(size_t count);
+
+  /// number of samples ready to be read
+  size_t readAvailable() const;
+
+  /// number of samples that can be written without overrun
+  size_t writeAvailable() const;
+
+  size_t capacity() const;
+
+private:
+  std::vector<T> buffer_; ///< power of two sized so indices wrap by masking
+  size_t mask_;
+  std::atomic<size_t> readIndex_; ///< monotonic consumer position
+  std::atomic<size_t> writeIndex_; ///< monotonic producer position
+};
+
+} // namespace audio
+
+#include "AudioRingBuffer_impl.h"
+
+#endif // AUDIO_RING_BUFFER_H
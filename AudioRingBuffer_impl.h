@@ -0,0 +1,107 @@
+#ifndef AUDIO_RING_BUFFER_IMPL_H
+#define AUDIO_RING_BUFFER_IMPL_H
+
+#ifndef AUDIO_RING_BUFFER_H
+#error "Include via AudioRingBuffer.h"
+#endif // AUDIO_RING_BUFFER_H
+
+#include <algorithm>
+
+namespace audio {
+
+template<typename T>
+RingBuffer<T>::RingBuffer()
+  : mask_(0)
+  , readIndex_(0)
+  , writeIndex_(0)
+{}
+
+template<typename T>
+RingBuffer<T>::RingBuffer(size_t capacity)
+  : RingBuffer()
+{
+  reset(capacity);
+}
+
+template<typename T>
+void RingBuffer<T>::reset(size_t capacity)
+{
+  size_t size = 1;
+  while(size < capacity) {
+    size <<= 1;
+  }
+
+  buffer_.assign(size, T());
+  mask_ = size - 1;
+  readIndex_.store(0, std::memory_order_relaxed);
+  writeIndex_.store(0, std::memory_order_relaxed);
+}
+
+template<typename T>
+size_t RingBuffer<T>::write(const T* samples, size_t count)
+{
+  const auto write = writeIndex_.load(std::memory_order_relaxed);
+  const auto read = readIndex_.load(std::memory_order_acquire);
+
+  count = std::min(count, buffer_.size() - (write - read));
+
+  // copy in up to two parts around the wrap
+  const auto offset = write & mask_;
+  const auto first = std::min(count, buffer_.size() - offset);
+  std::copy(samples, samples + first, buffer_.data() + offset);
+  std::copy(samples + first, samples + count, buffer_.data());
+
+  writeIndex_.store(write + count, std::memory_order_release);
+  return count;
+}
+
+template<typename T>
+size_t RingBuffer<T>::read(T* samples, size_t count)
+{
+  const auto read = readIndex_.load(std::memory_order_relaxed);
+  const auto write = writeIndex_.load(std::memory_order_acquire);
+
+  count = std::min(count, write - read);
+
+  const auto offset = read & mask_;
+  const auto first = std::min(count, buffer_.size() - offset);
+  std::copy(buffer_.data() + offset, buffer_.data() + offset + first, samples);
+  std::copy(buffer_.data(), buffer_.data() + (count - first), samples + first);
+
+  readIndex_.store(read + count, std::memory_order_release);
+  return count;
+}
+
+template<typename T>
+size_t RingBuffer<T>::skip(size_t count)
+{
+  const auto read = readIndex_.load(std::memory_order_relaxed);
+  const auto write = writeIndex_.load(std::memory_order_acquire);
+
+  count = std::min(count, write - read);
+
+  readIndex_.store(read + count, std::memory_order_release);
+  return count;
+}
+
+template<typename T>
+size_t RingBuffer<T>::readAvailable() const
+{
+  return writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_acquire);
+}
+
+template<typename T>
+size_t RingBuffer<T>::writeAvailable() const
+{
+  return buffer_.size() - readAvailable();
+}
+
+template<typename T>
+size_t RingBuffer<T>::capacity() const
+{
+  return buffer_.size();
+}
+
+} // namespace audio
+
+#endif // AUDIO_RING_BUFFER_IMPL_H
@@ -1,12 +1,17 @@
 #ifndef AUDIO_SEQUENCE_H
 #define AUDIO_SEQUENCE_H
 
+#include "AudioSpill.h"
 #include "SdlGuard.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <iterator>
-#include <list>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace audio {
@@ -15,25 +20,36 @@ struct Metadata
 {
   int sampleRate = 48000; // sampling frequency [Hz]
   uint8_t channelCount = 1; // number of channels to record in parallel (i.e. mono/stereo)
-  uint16_t sampleCount = 4096; // number of samples to capture in one group
+  uint16_t sampleCount = 4096; // number of samples (per channel) to capture in one group
+
+  /// number of samples of all channels in one complete capture group
+  constexpr size_t groupSize() const { return static_cast<size_t>(sampleCount) * channelCount; }
 };
 
 template<typename T>
 struct SequenceIterator;
 
+template<typename T>
+struct SequenceChannel;
+
 template<typename T>
 struct Sequence
 {
+  using value_type = T;
   using Samples = std::vector<T>;
-  using Storage = std::list<Samples>;
+  using Storage = std::deque<Samples>; ///< page table of capture groups; O(1) indexing and front removal
   using iterator = SequenceIterator<T>;
   using const_iterator = SequenceIterator<const T>;
 
   Metadata metadata; ///< constant sequence metadata the samples were recorded with
-  Storage storage; ///< samples in capture groups
+  Storage storage; ///< samples in capture groups of metadata.groupSize() each (only the last may be shorter);
+                   ///< each group is planar, i.e. holds all samples of the first channel, then of the second, ...
+                   ///< resident groups only, following the spilled ones
+  Spilled<T> spilled; ///< leading capture groups paged out to disk by spill(); the file is shared by copies of the sequence
 
-  /// enqueue sample capture group
+  /// enqueue sample capture group from an interleaved device stream
   void push(const uint8_t* stream, int len);
+  /// enqueue planar sample capture group
   template<typename FwdIt>
   void push(FwdIt first, FwdIt last);
   void push(Samples samples);
@@ -42,14 +58,46 @@ struct Sequence
   /// @return  filled capture group or empty if none remaining
   std::vector<T> pop();
 
+  /// grow or shrink to the given number of samples, appending value-initialized capture groups
+  void resize(size_t count);
+
+  /// page out all complete capture groups but the last residentCount to a temporary file
+  /// in one sequential write; they are paged back in transparently when accessed
+  /// @param cacheCount  number of spilled groups kept in memory once paged in, for reading and for writing each
+  /// @note  spilled groups written to (including by non-const iteration) are written back once evicted,
+  ///        leaving copies of the sequence unaffected
+  void spill(size_t residentCount, size_t cacheCount = detail::spillCacheCount);
+
+  /// number of capture groups, spilled or resident
+  size_t groupCount() const;
+
+  /// samples of a capture group for writing, paged in if spilled
+  /// @note  a spilled group may be written back and dropped from memory once cacheCount other spilled groups
+  ///        were written to since; hold it via pinGroup() (as iterators do) for longer or concurrent access
+  Samples& group(size_t index);
+
+  /// samples of a capture group, paged in if spilled;
+  /// a paged in group stays valid (and, for writing, is not written back) as long as the returned pointer is held
+  std::shared_ptr<Samples> pinGroup(size_t index);
+  std::shared_ptr<const Samples> pinGroup(size_t index) const;
+
   /// determine playback length of all samples in recording
   std::chrono::milliseconds duration() const;
 
+  /// access samples of all channels in storage order; read-only access is by value
   typename Samples::reference operator[](size_t pos);
-  typename Samples::const_reference operator[](size_t pos) const;
+  value_type operator[](size_t pos) const;
 
+  /// number of samples of all channels
   size_t size() const;
 
+  /// number of samples per channel
+  size_t frameCount() const;
+
+  /// access the samples of a single channel
+  SequenceChannel<T> channel(uint8_t index);
+  SequenceChannel<const T> channel(uint8_t index) const;
+
   iterator begin();
   iterator end();
 
@@ -57,38 +105,183 @@ struct Sequence
   const_iterator end() const;
 };
 
+/// random access iterator over all samples of a sequence,
+/// advancing by pointer within a capture group and via the page table across groups
+/// @note  iterators keep the spilled group they point into paged in
 template<typename T>
 struct SequenceIterator
 {
-  using iterator_category = std::bidirectional_iterator_tag;
-  using value_type = T;
-  using difference_type = size_t;
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = typename std::remove_const<T>::type;
+  using difference_type = std::ptrdiff_t;
   using pointer = T*;
   using reference = T&;
+  using sequence_type = typename std::conditional<
+    std::is_const<T>::value,
+    const Sequence<value_type>,
+    Sequence<value_type>>::type;
 
   SequenceIterator();
-  SequenceIterator(Sequence<T>* seq);
+  SequenceIterator(sequence_type* seq, size_t group);
 
   reference operator*() const;
   pointer operator->() const;
+  reference operator[](difference_type n) const;
 
   SequenceIterator& operator++();
   SequenceIterator& operator--();
 
-  SequenceIterator& operator++(int);
-  SequenceIterator& operator--(int);
+  SequenceIterator operator++(int);
+  SequenceIterator operator--(int);
+
+  SequenceIterator& operator+=(difference_type n);
+  SequenceIterator& operator-=(difference_type n);
+
+  SequenceIterator operator+(difference_type n) const;
+  SequenceIterator operator-(difference_type n) const;
+  difference_type operator-(const SequenceIterator& other) const;
 
   bool operator==(const SequenceIterator& other) const;
   bool operator!=(const SequenceIterator& other) const;
+  bool operator<(const SequenceIterator& other) const;
+  bool operator>(const SequenceIterator& other) const;
+  bool operator<=(const SequenceIterator& other) const;
+  bool operator>=(const SequenceIterator& other) const;
 
-  operator SequenceIterator<const T>();
+  /// end of the contiguous run of samples the iterator points into;
+  /// [&*it, it.segmentEnd()) may be processed as plain array
+  pointer segmentEnd() const;
+
+  operator SequenceIterator<const T>() const;
 
 private:
-  Sequence<T>* seq_;
-  typename Sequence<T>::Storage::iterator storage_;
-  typename Sequence<T>::Samples::iterator sample_;
+  template<typename>
+  friend struct SequenceIterator;
+
+  /// point to the first sample of the given group (or past-the-end)
+  void seek(size_t group);
+
+  /// index of the sample pointed to within the whole sequence
+  size_t position() const;
+
+  /// point to the sample at the given index within the whole sequence (or past-the-end)
+  void seekPosition(size_t pos);
+
+private:
+  sequence_type* seq_;
+  size_t group_; ///< index of the current capture group in the sequence storage
+  std::shared_ptr<const void> page_; ///< keeps a paged in group alive while pointed into
+  pointer sample_; ///< current sample within the contiguous group
+  pointer groupBegin_;
+  pointer groupEnd_;
 };
 
+template<typename T>
+SequenceIterator<T> operator+(typename SequenceIterator<T>::difference_type n, const SequenceIterator<T>& it);
+
+template<typename T>
+struct ChannelIterator;
+
+/// samples of one channel of a sequence, addressed by frame
+template<typename T>
+struct SequenceChannel
+{
+  using value_type = typename std::remove_const<T>::type;
+  using reference = typename std::conditional<std::is_const<T>::value, value_type, T&>::type; ///< read-only access is by value
+  using iterator = ChannelIterator<T>;
+  using const_iterator = ChannelIterator<T>;
+  using sequence_type = typename std::conditional<
+    std::is_const<T>::value,
+    const Sequence<value_type>,
+    Sequence<value_type>>::type;
+
+  Metadata metadata; ///< sequence metadata reduced to this single channel
+
+  SequenceChannel(sequence_type* seq, uint8_t index);
+
+  reference operator[](size_t frame) const;
+
+  size_t size() const;
+
+  iterator begin() const;
+  iterator end() const;
+
+private:
+  sequence_type* seq_;
+  uint8_t index_;
+};
+
+/// random access iterator over the samples of one channel
+template<typename T>
+struct ChannelIterator
+{
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = typename std::remove_const<T>::type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T*;
+  using reference = typename SequenceChannel<T>::reference;
+
+  ChannelIterator(const SequenceChannel<T>& channel, size_t frame);
+
+  reference operator*() const;
+  reference operator[](difference_type n) const;
+
+  ChannelIterator& operator++();
+  ChannelIterator& operator--();
+
+  ChannelIterator operator++(int);
+  ChannelIterator operator--(int);
+
+  ChannelIterator& operator+=(difference_type n);
+  ChannelIterator& operator-=(difference_type n);
+
+  ChannelIterator operator+(difference_type n) const;
+  ChannelIterator operator-(difference_type n) const;
+  difference_type operator-(const ChannelIterator& other) const;
+
+  bool operator==(const ChannelIterator& other) const;
+  bool operator!=(const ChannelIterator& other) const;
+  bool operator<(const ChannelIterator& other) const;
+  bool operator>(const ChannelIterator& other) const;
+  bool operator<=(const ChannelIterator& other) const;
+  bool operator>=(const ChannelIterator& other) const;
+
+private:
+  SequenceChannel<T> channel_;
+  size_t frame_;
+};
+
+namespace detail {
+  /// storage position of a channel's frame within planar capture groups
+  /// @param size  number of samples of all channels in the sequence
+  inline size_t planarIndex(const Metadata& metadata, size_t size, uint8_t channel, size_t frame)
+  {
+    const size_t groupFrames = metadata.sampleCount;
+    const auto groupFirst = (frame / groupFrames) * metadata.groupSize();
+
+    // the last group may hold fewer frames per channel
+    const auto frames = std::min(groupFrames, (size - groupFirst) / metadata.channelCount);
+    return groupFirst + channel * frames + frame % groupFrames;
+  }
+
+  struct PlanarPosition
+  {
+    uint8_t channel;
+    size_t frame;
+  };
+
+  /// channel and frame of a storage position within planar capture groups, the inverse of planarIndex()
+  /// @param size  number of samples of all channels in the sequence
+  inline PlanarPosition planarPosition(const Metadata& metadata, size_t size, size_t pos)
+  {
+    const auto groupSize = metadata.groupSize();
+    const auto groupFirst = pos - pos % groupSize;
+    const auto frames = std::min<size_t>(metadata.sampleCount, (size - groupFirst) / metadata.channelCount);
+    const auto offset = pos - groupFirst;
+    return PlanarPosition{static_cast<uint8_t>(offset / frames), groupFirst / metadata.channelCount + offset % frames};
+  }
+} // namespace detail
+
 } // namespace audio
 
 #include "AudioSequence_impl.h"
@@ -5,17 +5,35 @@
 #error "Include via AudioSequence.h"
 #endif // AUDIO_SEQUENCE_H
 
+#include "AudioChannels.h"
+
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <stdexcept>
 
 namespace audio {
 
+namespace detail {
+  /// samples of a capture group for iteration, keeping a spilled group paged in via page
+  template<typename Seq>
+  auto pinGroup(Seq& seq, size_t index, std::shared_ptr<const void>& page) -> decltype(*seq.pinGroup(index))
+  {
+    auto pinned = seq.pinGroup(index);
+    page = pinned;
+    return *pinned;
+  }
+} // namespace detail
+
 template<typename T>
 void Sequence<T>::push(const uint8_t* stream, int len)
 {
   const auto first = reinterpret_cast<const T*>(stream);
-  const auto last = reinterpret_cast<const T*>(stream + len);
+  const auto frames = static_cast<size_t>(len) / sizeof(T) / metadata.channelCount;
 
-  push(first, last);
+  Samples samples(frames * metadata.channelCount);
+  deinterleave(first, frames, metadata.channelCount, samples.data(), frames);
+  push(std::move(samples));
 }
 
 template<typename T>
@@ -34,6 +52,10 @@ void Sequence<T>::push(Samples samples)
 template<typename T>
 std::vector<T> Sequence<T>::pop()
 {
+  if(spilled.count() > 0) {
+    return spilled.pop();
+  }
+
   if(storage.empty()) {
     return {};
   }
@@ -43,99 +65,250 @@ std::vector<T> Sequence<T>::pop()
   return ret;
 }
 
+template<typename T>
+void Sequence<T>::resize(size_t count)
+{
+  const auto groupSize = metadata.groupSize();
+  const auto groupCount = (count + groupSize - 1) / groupSize;
+
+  // spilled groups beyond the new end are dropped without paging them in,
+  // a spilled group becoming the (shorter) last one is moved back to memory
+  if(groupCount <= spilled.count()) {
+    storage.clear();
+    if(count % groupSize != 0) {
+      storage.push_back(*spilled.load(groupCount - 1));
+      spilled.truncate(groupCount - 1);
+    } else {
+      spilled.truncate(groupCount);
+    }
+  }
+  count -= spilled.count() * groupSize;
+
+  storage.resize((count + groupSize - 1) / groupSize);
+  for(auto&& samples : storage) {
+    samples.resize(std::min(groupSize, count));
+    count -= samples.size();
+  }
+}
+
 template<typename T>
 std::chrono::milliseconds Sequence<T>::duration() const
 {
   assert(metadata.sampleRate > 0);
-  return std::chrono::milliseconds((storage.size() * metadata.sampleCount) / (metadata.sampleRate / 1000));
+  return std::chrono::milliseconds(static_cast<uint64_t>(frameCount()) * 1000 / metadata.sampleRate);
+}
+
+template<typename T>
+void Sequence<T>::spill(size_t residentCount, size_t cacheCount)
+{
+  // only complete groups are paged out, so positions still follow from the uniform group size
+  const auto groupSize = metadata.groupSize();
+  const auto last = (storage.size() > residentCount ? storage.size() - residentCount : 0);
+  size_t count = 0;
+  while(count < last && storage[count].size() == groupSize) {
+    ++count;
+  }
+  if(count == 0 && spilled.count() == 0) {
+    return;
+  }
+
+  spilled.append(std::begin(storage), std::begin(storage) + static_cast<std::ptrdiff_t>(count), groupSize, cacheCount);
+  (void)storage.erase(std::begin(storage), std::begin(storage) + static_cast<std::ptrdiff_t>(count));
+}
+
+template<typename T>
+size_t Sequence<T>::groupCount() const
+{
+  return spilled.count() + storage.size();
+}
+
+template<typename T>
+typename Sequence<T>::Samples& Sequence<T>::group(size_t index)
+{
+  // only spilled groups take a lock
+  const auto spilledCount = spilled.count();
+  if(index >= spilledCount) {
+    return storage[index - spilledCount];
+  }
+  return *spilled.modify(index);
+}
+
+template<typename T>
+std::shared_ptr<typename Sequence<T>::Samples> Sequence<T>::pinGroup(size_t index)
+{
+  const auto spilledCount = spilled.count();
+  if(index >= spilledCount) {
+    // resident groups need no pinning, the pointer does not own them
+    return std::shared_ptr<Samples>(std::shared_ptr<Samples>(), &storage[index - spilledCount]);
+  }
+  return spilled.modify(index);
+}
+
+template<typename T>
+std::shared_ptr<const typename Sequence<T>::Samples> Sequence<T>::pinGroup(size_t index) const
+{
+  const auto spilledCount = spilled.count();
+  if(index >= spilledCount) {
+    return std::shared_ptr<const Samples>(std::shared_ptr<const Samples>(), &storage[index - spilledCount]);
+  }
+  return spilled.load(index);
 }
 
 template<typename T>
 typename Sequence<T>::Samples::reference Sequence<T>::operator[](size_t pos)
 {
-  auto store = pos / metadata.sampleCount;
-  auto sample = pos % metadata.sampleCount;
-  return (*std::next(std::begin(storage), store))[sample];
+  // groups are of uniform size, so the page table is indexed directly
+  auto store = pos / metadata.groupSize();
+  auto sample = pos % metadata.groupSize();
+  return group(store)[sample];
 }
 
 template<typename T>
-typename Sequence<T>::Samples::const_reference Sequence<T>::operator[](size_t pos) const
+typename Sequence<T>::value_type Sequence<T>::operator[](size_t pos) const
 {
-  auto store = pos / metadata.sampleCount;
-  auto sample = pos % metadata.sampleCount;
-  return (*std::next(std::begin(storage), store))[sample];
+  auto store = pos / metadata.groupSize();
+  auto sample = pos % metadata.groupSize();
+  const auto spilledCount = spilled.count();
+  if(store >= spilledCount) {
+    return storage[store - spilledCount][sample];
+  }
+  return (*spilled.load(store))[sample];
 }
 
 template<typename T>
 size_t Sequence<T>::size() const
 {
+  // spilled groups are complete
+  const auto spilledSize = spilled.count() * metadata.groupSize();
   if(storage.empty()) {
-    return 0;
+    return spilledSize;
   }
-  return (storage.size() - 1) * metadata.sampleCount + storage.back().size();
+  return spilledSize + (storage.size() - 1) * metadata.groupSize() + storage.back().size();
+}
+
+template<typename T>
+size_t Sequence<T>::frameCount() const
+{
+  return size() / metadata.channelCount;
+}
+
+template<typename T>
+SequenceChannel<T> Sequence<T>::channel(uint8_t index)
+{
+  return SequenceChannel<T>(this, index);
+}
+
+template<typename T>
+SequenceChannel<const T> Sequence<T>::channel(uint8_t index) const
+{
+  return SequenceChannel<const T>(this, index);
 }
 
 template<typename T>
 typename Sequence<T>::iterator Sequence<T>::begin()
 {
-  return Sequence<T>::iterator(const_cast<Sequence<T>*>(this));
+  return Sequence<T>::iterator(this, 0);
 }
 
 template<typename T>
 typename Sequence<T>::iterator Sequence<T>::end()
 {
-  return Sequence<T>::iterator();
+  return Sequence<T>::iterator(this, groupCount());
 }
 
 template<typename T>
 typename Sequence<T>::const_iterator Sequence<T>::begin() const
 {
-  return Sequence<T>::const_iterator(const_cast<Sequence<T>*>(this));
+  return Sequence<T>::const_iterator(this, 0);
 }
 
 template<typename T>
 typename Sequence<T>::const_iterator Sequence<T>::end() const
 {
-  return Sequence<T>::const_iterator();
+  return Sequence<T>::const_iterator(this, groupCount());
 }
 
 
 template<typename T>
 SequenceIterator<T>::SequenceIterator()
   : seq_(nullptr)
+  , group_(0)
+  , sample_(nullptr)
+  , groupBegin_(nullptr)
+  , groupEnd_(nullptr)
 {}
 
 template<typename T>
-SequenceIterator<T>::SequenceIterator(Sequence<T>* seq)
+SequenceIterator<T>::SequenceIterator(sequence_type* seq, size_t group)
   : seq_(seq)
-  , storage_(std::begin(seq->storage))
 {
-  if(storage_ != std::end(seq->storage)) {
-    sample_ = std::begin(*storage_);
+  seek(group);
+}
+
+template<typename T>
+void SequenceIterator<T>::seek(size_t group)
+{
+  // skip empty groups so the sample pointer is always dereferenceable
+  for(group_ = group; group_ < seq_->groupCount(); ++group_) {
+    auto&& samples = detail::pinGroup(*seq_, group_, page_);
+    if(!samples.empty()) {
+      groupBegin_ = samples.data();
+      groupEnd_ = groupBegin_ + samples.size();
+      sample_ = groupBegin_;
+      return;
+    }
   }
+  group_ = seq_->groupCount();
+  page_.reset();
+  sample_ = groupBegin_ = groupEnd_ = nullptr;
+}
+
+template<typename T>
+size_t SequenceIterator<T>::position() const
+{
+  if(group_ == seq_->groupCount()) {
+    return seq_->size();
+  }
+  return group_ * seq_->metadata.groupSize() + static_cast<size_t>(sample_ - groupBegin_);
+}
+
+template<typename T>
+void SequenceIterator<T>::seekPosition(size_t pos)
+{
+  if(pos >= seq_->size()) {
+    seek(seq_->groupCount());
+    return;
+  }
+
+  // groups are of uniform size, so the page table is indexed directly
+  seek(pos / seq_->metadata.groupSize());
+  sample_ += pos % seq_->metadata.groupSize();
 }
 
 template<typename T>
 typename SequenceIterator<T>::reference SequenceIterator<T>::operator*() const
 {
-  return sample_.operator*();
+  return *sample_;
 }
 
 template<typename T>
 typename SequenceIterator<T>::pointer SequenceIterator<T>::operator->() const
 {
-  return sample_.operator->();
+  return sample_;
+}
+
+template<typename T>
+typename SequenceIterator<T>::reference SequenceIterator<T>::operator[](difference_type n) const
+{
+  return *(*this + n);
 }
 
 template<typename T>
 SequenceIterator<T>& SequenceIterator<T>::operator++()
 {
-  if(++sample_ == std::end(*storage_)) {
-    if(++storage_ != std::end(seq_->storage)) {
-      sample_ = std::begin(*storage_);
-    } else {
-      *this = SequenceIterator();
-    }
+  // stay within the contiguous group as long as possible
+  if(++sample_ == groupEnd_) {
+    seek(group_ + 1);
   }
   return *this;
 }
@@ -143,18 +316,31 @@ SequenceIterator<T>& SequenceIterator<T>::operator++()
 template<typename T>
 SequenceIterator<T>& SequenceIterator<T>::operator--()
 {
-  if(sample_-- == std::begin(*storage_)) {
-    if(storage_-- != std::begin(seq_->storage)) {
-      sample_ = std::prev(std::end(*storage_));
-    } else {
-      *this = SequenceIterator();
+  if(sample_ != groupBegin_) {
+    --sample_;
+    return *this;
+  }
+
+  // walk back to the previous non-empty group
+  auto group = group_;
+  while(group-- > 0) {
+    std::shared_ptr<const void> page;
+    auto&& samples = detail::pinGroup(*seq_, group, page);
+    if(!samples.empty()) {
+      group_ = group;
+      page_ = std::move(page);
+      groupBegin_ = samples.data();
+      groupEnd_ = groupBegin_ + samples.size();
+      sample_ = groupEnd_ - 1;
+      return *this;
     }
   }
+  *this = SequenceIterator();
   return *this;
 }
 
 template<typename T>
-SequenceIterator<T>& SequenceIterator<T>::operator++(int)
+SequenceIterator<T> SequenceIterator<T>::operator++(int)
 {
   auto tmp = *this;
   ++(*this);
@@ -162,29 +348,265 @@ SequenceIterator<T>& SequenceIterator<T>::operator++(int)
 }
 
 template<typename T>
-SequenceIterator<T>& SequenceIterator<T>::operator--(int)
+SequenceIterator<T> SequenceIterator<T>::operator--(int)
 {
   auto tmp = *this;
   --(*this);
   return tmp;
 }
 
+template<typename T>
+SequenceIterator<T>& SequenceIterator<T>::operator+=(difference_type n)
+{
+  // short cut within the current group
+  if((n >= 0) ? (n < groupEnd_ - sample_) : (-n <= sample_ - groupBegin_)) {
+    sample_ += n;
+    return *this;
+  }
+  seekPosition(static_cast<size_t>(static_cast<difference_type>(position()) + n));
+  return *this;
+}
+
+template<typename T>
+SequenceIterator<T>& SequenceIterator<T>::operator-=(difference_type n)
+{
+  return *this += -n;
+}
+
+template<typename T>
+SequenceIterator<T> SequenceIterator<T>::operator+(difference_type n) const
+{
+  auto tmp = *this;
+  return tmp += n;
+}
+
+template<typename T>
+SequenceIterator<T> SequenceIterator<T>::operator-(difference_type n) const
+{
+  auto tmp = *this;
+  return tmp -= n;
+}
+
+template<typename T>
+typename SequenceIterator<T>::difference_type SequenceIterator<T>::operator-(const SequenceIterator& other) const
+{
+  return static_cast<difference_type>(position()) - static_cast<difference_type>(other.position());
+}
+
 template<typename T>
 bool SequenceIterator<T>::operator==(const SequenceIterator& other) const
 {
-  return true &&
-      (seq_ == other.seq_) &&
-      (storage_ == other.storage_) &&
-      (sample_ == other.sample_);
+  // paged in groups may be held at different addresses by different iterators
+  return (seq_ == other.seq_) &&
+      (group_ == other.group_) &&
+      ((sample_ == other.sample_) || (sample_ - groupBegin_ == other.sample_ - other.groupBegin_));
 }
 
 template<typename T>
 bool SequenceIterator<T>::operator!=(const SequenceIterator& other) const
 {
-  return false ||
-      (seq_ != other.seq_) ||
-      (storage_ != other.storage_) ||
-      (sample_ != other.sample_);
+  return !(*this == other);
+}
+
+template<typename T>
+bool SequenceIterator<T>::operator<(const SequenceIterator& other) const
+{
+  return (group_ < other.group_) || ((group_ == other.group_) && (sample_ - groupBegin_ < other.sample_ - other.groupBegin_));
+}
+
+template<typename T>
+bool SequenceIterator<T>::operator>(const SequenceIterator& other) const
+{
+  return other < *this;
+}
+
+template<typename T>
+bool SequenceIterator<T>::operator<=(const SequenceIterator& other) const
+{
+  return !(other < *this);
+}
+
+template<typename T>
+bool SequenceIterator<T>::operator>=(const SequenceIterator& other) const
+{
+  return !(*this < other);
+}
+
+template<typename T>
+typename SequenceIterator<T>::pointer SequenceIterator<T>::segmentEnd() const
+{
+  return groupEnd_;
+}
+
+template<typename T>
+SequenceIterator<T>::operator SequenceIterator<const T>() const
+{
+  SequenceIterator<const T> ret;
+  ret.seq_ = seq_;
+  ret.group_ = group_;
+  ret.page_ = page_;
+  ret.sample_ = sample_;
+  ret.groupBegin_ = groupBegin_;
+  ret.groupEnd_ = groupEnd_;
+  return ret;
+}
+
+template<typename T>
+SequenceIterator<T> operator+(typename SequenceIterator<T>::difference_type n, const SequenceIterator<T>& it)
+{
+  return it + n;
+}
+
+
+template<typename T>
+SequenceChannel<T>::SequenceChannel(sequence_type* seq, uint8_t index)
+  : metadata(seq->metadata)
+  , seq_(seq)
+  , index_(index)
+{
+  assert(index < seq->metadata.channelCount);
+  metadata.channelCount = 1;
+}
+
+template<typename T>
+typename SequenceChannel<T>::reference SequenceChannel<T>::operator[](size_t frame) const
+{
+  return (*seq_)[detail::planarIndex(seq_->metadata, seq_->size(), index_, frame)];
+}
+
+template<typename T>
+size_t SequenceChannel<T>::size() const
+{
+  return seq_->frameCount();
+}
+
+template<typename T>
+typename SequenceChannel<T>::iterator SequenceChannel<T>::begin() const
+{
+  return iterator(*this, 0);
+}
+
+template<typename T>
+typename SequenceChannel<T>::iterator SequenceChannel<T>::end() const
+{
+  return iterator(*this, size());
+}
+
+
+template<typename T>
+ChannelIterator<T>::ChannelIterator(const SequenceChannel<T>& channel, size_t frame)
+  : channel_(channel)
+  , frame_(frame)
+{}
+
+template<typename T>
+typename ChannelIterator<T>::reference ChannelIterator<T>::operator*() const
+{
+  return channel_[frame_];
+}
+
+template<typename T>
+typename ChannelIterator<T>::reference ChannelIterator<T>::operator[](difference_type n) const
+{
+  return channel_[frame_ + n];
+}
+
+template<typename T>
+ChannelIterator<T>& ChannelIterator<T>::operator++()
+{
+  ++frame_;
+  return *this;
+}
+
+template<typename T>
+ChannelIterator<T>& ChannelIterator<T>::operator--()
+{
+  --frame_;
+  return *this;
+}
+
+template<typename T>
+ChannelIterator<T> ChannelIterator<T>::operator++(int)
+{
+  auto tmp = *this;
+  ++frame_;
+  return tmp;
+}
+
+template<typename T>
+ChannelIterator<T> ChannelIterator<T>::operator--(int)
+{
+  auto tmp = *this;
+  --frame_;
+  return tmp;
+}
+
+template<typename T>
+ChannelIterator<T>& ChannelIterator<T>::operator+=(difference_type n)
+{
+  frame_ += n;
+  return *this;
+}
+
+template<typename T>
+ChannelIterator<T>& ChannelIterator<T>::operator-=(difference_type n)
+{
+  frame_ -= n;
+  return *this;
+}
+
+template<typename T>
+ChannelIterator<T> ChannelIterator<T>::operator+(difference_type n) const
+{
+  return ChannelIterator(channel_, frame_ + n);
+}
+
+template<typename T>
+ChannelIterator<T> ChannelIterator<T>::operator-(difference_type n) const
+{
+  return ChannelIterator(channel_, frame_ - n);
+}
+
+template<typename T>
+typename ChannelIterator<T>::difference_type ChannelIterator<T>::operator-(const ChannelIterator& other) const
+{
+  return static_cast<difference_type>(frame_) - static_cast<difference_type>(other.frame_);
+}
+
+template<typename T>
+bool ChannelIterator<T>::operator==(const ChannelIterator& other) const
+{
+  return frame_ == other.frame_;
+}
+
+template<typename T>
+bool ChannelIterator<T>::operator!=(const ChannelIterator& other) const
+{
+  return frame_ != other.frame_;
+}
+
+template<typename T>
+bool ChannelIterator<T>::operator<(const ChannelIterator& other) const
+{
+  return frame_ < other.frame_;
+}
+
+template<typename T>
+bool ChannelIterator<T>::operator>(const ChannelIterator& other) const
+{
+  return frame_ > other.frame_;
+}
+
+template<typename T>
+bool ChannelIterator<T>::operator<=(const ChannelIterator& other) const
+{
+  return frame_ <= other.frame_;
+}
+
+template<typename T>
+bool ChannelIterator<T>::operator>=(const ChannelIterator& other) const
+{
+  return frame_ >= other.frame_;
 }
 
 } // namespace audio
@@ -0,0 +1,97 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include "AudioSequence.h"
+#include "AudioView.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace audio {
+
+/// interleaved samples pulled block by block, e.g. by the playback device callback
+/// @note  read() must not block or allocate when called from a device callback; a source waiting
+///        for samples (e.g. fed by another thread) provides silence meanwhile rather than reading short
+template<typename T>
+struct Source
+{
+  using value_type = T;
+
+  virtual ~Source() = default;
+
+  /// copy the next samples and advance
+  /// @return  number of samples copied, less than count only once exhausted; consumers treat a short read as the end
+  virtual size_t read(T* samples, size_t count) = 0;
+};
+
+/// read position within a shared sequence, interleaving its planar capture groups
+template<typename T>
+struct SequenceSource : Source<T>
+{
+  SequenceSource(std::shared_ptr<const Sequence<T>> seq);
+
+  size_t read(T* samples, size_t count) override;
+
+private:
+  std::shared_ptr<const Sequence<T>> seq_;
+  size_t group_;
+  size_t frame_;
+};
+
+/// read position within a lazy view, interleaving its planar capture groups
+/// @note  the viewed sequence has to outlive the source
+template<typename T, typename Mapping>
+struct ViewSource : Source<T>
+{
+  ViewSource(View<Mapping> view);
+
+  size_t read(T* samples, size_t count) override;
+
+private:
+  View<Mapping> view_;
+  size_t frame_;
+};
+
+/// samples rendered on demand by a mono generator (see AudioGenerator.h),
+/// duplicated to all channels
+template<typename Generator>
+struct GeneratorSource : Source<float>
+{
+  /// @param frameCount  number of samples per channel to render; 0 for an endless signal
+  GeneratorSource(const Metadata& metadata, Generator generator, size_t frameCount = 0);
+
+  size_t read(float* samples, size_t count) override;
+
+private:
+  Metadata metadata_;
+  Generator generator_;
+  size_t remaining_; ///< frames left to render, unless endless
+  bool isEndless_;
+  std::vector<float> mono_; ///< render buffer of one capture group
+};
+
+/// samples of an upstream source, processed in place block by block by processor(samples, count)
+template<typename T, typename Processor>
+struct ProcessSource : Source<T>
+{
+  ProcessSource(std::unique_ptr<Source<T>> upstream, Processor processor);
+
+  size_t read(T* samples, size_t count) override;
+
+private:
+  std::unique_ptr<Source<T>> upstream_;
+  Processor processor_;
+};
+
+template<typename Generator>
+std::unique_ptr<Source<float>> generatorSource(const Metadata& metadata, Generator generator, size_t frameCount = 0);
+
+template<typename T, typename Processor>
+std::unique_ptr<Source<T>> process(std::unique_ptr<Source<T>> upstream, Processor processor);
+
+} // namespace audio
+
+#include "AudioSource_impl.h"
+
+#endif // AUDIO_SOURCE_H
@@ -0,0 +1,137 @@
+#ifndef AUDIO_SOURCE_IMPL_H
+#define AUDIO_SOURCE_IMPL_H
+
+#ifndef AUDIO_SOURCE_H
+#error "Include via AudioSource.h"
+#endif // AUDIO_SOURCE_H
+
+#include "AudioChannels.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace audio {
+
+template<typename T>
+SequenceSource<T>::SequenceSource(std::shared_ptr<const Sequence<T>> seq)
+  : seq_(std::move(seq))
+  , group_(0)
+  , frame_(0)
+{
+}
+
+template<typename T>
+size_t SequenceSource<T>::read(T* samples, size_t count)
+{
+  // planar groups are interleaved into whole frames for the device
+  const size_t channelCount = seq_->metadata.channelCount;
+  size_t done = 0;
+  while((done + channelCount <= count) && (group_ < seq_->groupCount())) {
+    const auto pinned = seq_->pinGroup(group_);
+    auto&& group = *pinned;
+    const auto groupFrames = group.size() / channelCount;
+    const auto n = std::min(groupFrames - frame_, (count - done) / channelCount);
+    interleave(group.data() + frame_, groupFrames, n, channelCount, samples + done);
+    done += n * channelCount;
+
+    frame_ += n;
+    if(frame_ == groupFrames) {
+      ++group_;
+      frame_ = 0;
+    }
+  }
+  return done;
+}
+
+template<typename T, typename Mapping>
+ViewSource<T, Mapping>::ViewSource(View<Mapping> view)
+  : view_(std::move(view))
+  , frame_(0)
+{
+}
+
+template<typename T, typename Mapping>
+size_t ViewSource<T, Mapping>::read(T* samples, size_t count)
+{
+  // planar groups are interleaved into whole frames for the device
+  const auto& metadata = view_.metadata;
+  const size_t channelCount = metadata.channelCount;
+  const auto size = view_.size();
+  const auto n = std::min(count / channelCount, size / channelCount - frame_);
+  for(size_t f = 0; f < n; ++f) {
+    for(uint8_t c = 0; c < channelCount; ++c) {
+      samples[f * channelCount + c] = view_[detail::planarIndex(metadata, size, c, frame_ + f)];
+    }
+  }
+  frame_ += n;
+  return n * channelCount;
+}
+
+template<typename Generator>
+GeneratorSource<Generator>::GeneratorSource(const Metadata& metadata, Generator generator, size_t frameCount)
+  : metadata_(metadata)
+  , generator_(std::move(generator))
+  , remaining_(frameCount)
+  , isEndless_(frameCount == 0)
+  , mono_(metadata.channelCount > 1 ? metadata.sampleCount : 0)
+{
+}
+
+template<typename Generator>
+size_t GeneratorSource<Generator>::read(float* samples, size_t count)
+{
+  const size_t channelCount = metadata_.channelCount;
+  auto frames = count / channelCount;
+  if(!isEndless_) {
+    frames = std::min(frames, remaining_);
+    remaining_ -= frames;
+  }
+
+  if(channelCount == 1) {
+    generator_.generate(samples, frames);
+    return frames;
+  }
+
+  // render mono, then duplicate into all channels
+  for(size_t done = 0; done < frames;) {
+    const auto n = std::min(mono_.size(), frames - done);
+    generator_.generate(mono_.data(), n);
+    for(size_t f = 0; f < n; ++f) {
+      std::fill_n(samples + (done + f) * channelCount, channelCount, mono_[f]);
+    }
+    done += n;
+  }
+  return frames * channelCount;
+}
+
+template<typename T, typename Processor>
+ProcessSource<T, Processor>::ProcessSource(std::unique_ptr<Source<T>> upstream, Processor processor)
+  : upstream_(std::move(upstream))
+  , processor_(std::move(processor))
+{
+}
+
+template<typename T, typename Processor>
+size_t ProcessSource<T, Processor>::read(T* samples, size_t count)
+{
+  count = upstream_->read(samples, count);
+  processor_(samples, count);
+  return count;
+}
+
+template<typename Generator>
+std::unique_ptr<Source<float>> generatorSource(const Metadata& metadata, Generator generator, size_t frameCount)
+{
+  return std::unique_ptr<Source<float>>(new GeneratorSource<Generator>(metadata, std::move(generator), frameCount));
+}
+
+template<typename T, typename Processor>
+std::unique_ptr<Source<T>> process(std::unique_ptr<Source<T>> upstream, Processor processor)
+{
+  return std::unique_ptr<Source<T>>(new ProcessSource<T, Processor>(std::move(upstream), std::move(processor)));
+}
+
+} // namespace audio
+
+#endif // AUDIO_SOURCE_IMPL_H
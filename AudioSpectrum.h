@@ -0,0 +1,138 @@
+#ifndef AUDIO_SPECTRUM_H
+#define AUDIO_SPECTRUM_H
+
+#include "AudioSequence.h"
+
+#include "kissfft/kissfft.hh"
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <vector>
+
+namespace audio {
+
+/// FFT of real sample blocks with plans (twiddle tables) cached per block size
+/// and scratch buffers reused, so repeated transforms do not allocate after warm-up
+template<typename T>
+struct SpectrumAnalyzer
+{
+  using Complex = std::complex<T>;
+  using Plan = kissfft<T>;
+
+  SpectrumAnalyzer() = default;
+  SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+  SpectrumAnalyzer(SpectrumAnalyzer&&) = default;
+
+  /// spectrum of one block of (an even number of) real samples
+  /// @return  blockSize / 2 complex bins, the first packing DC (real) and Nyquist (imaginary);
+  ///          valid until the next call
+  const std::vector<Complex>& transform(const T* samples, size_t blockSize);
+
+  /// spectra of all complete consecutive blocks of a sample source, summed up (complex)
+  /// @return  blockSize / 2 complex bins as for transform(); valid until the next call
+  template<typename Source>
+  const std::vector<Complex>& transformSum(const Source& source, size_t blockSize);
+
+  /// cross-correlation r[lag] = sum over n of signal[lag + n] * reference[n],
+  /// computed via FFT in O(n log n)
+  /// @return  signalSize values for the lags [0, signalSize); valid until the next call
+  const std::vector<T>& correlate(const T* signal, size_t signalSize, const T* reference, size_t referenceSize);
+
+  /// cached plan for a complex FFT of nfft points;
+  /// a real FFT of N samples uses the forward plan of N / 2 points
+  const Plan& plan(size_t nfft, bool isInverse = false);
+
+private:
+  std::map<std::pair<size_t, bool>, std::unique_ptr<Plan>> plans_;
+  std::vector<T> block_; ///< gathered samples of sources without contiguous storage
+  std::vector<Complex> transformed_;
+  std::vector<Complex> sum_;
+  std::vector<Complex> padded_; ///< zero-padded correlation input
+  std::vector<Complex> signalSpectrum_;
+  std::vector<Complex> referenceSpectrum_;
+  std::vector<T> correlation_;
+};
+
+/// segment weighting applied before transforming
+enum class Window
+{
+  Rectangular,
+  Hann,
+  Blackman
+};
+
+/// Welch power spectral density estimate of a single channel sample source,
+/// averaging the squared magnitudes of windowed, overlapping segments
+/// @param segmentSize  number of samples per segment; must be even
+/// @param hop  number of samples between consecutive segment starts, e.g. segmentSize / 2 for 50% overlap
+/// @return  one-sided density of segmentSize / 2 + 1 bins [1/Hz], bin k at k * sampleRate / segmentSize
+/// @note  segments are distributed across threads, each accumulating into its own spectrum
+template<typename Source>
+std::vector<typename std::remove_const<typename Source::value_type>::type> welch(
+    const Source& source,
+    size_t segmentSize,
+    size_t hop,
+    Window window = Window::Hann);
+
+/// incremental short-time Fourier transform of a live interleaved sample stream,
+/// emitting a power spectrum frame every hop samples into a bounded history
+/// @note  channels are mixed down; no allocation happens after construction
+template<typename T>
+struct Stft
+{
+  Metadata metadata; ///< layout of the consumed stream
+
+  /// @param frameSize  number of samples (per channel) per transform; must be even
+  /// @param hop  number of samples (per channel) between consecutive frames; at most frameSize
+  /// @param historyLength  number of most recent frames kept
+  Stft(const Metadata& metadata,
+       size_t frameSize,
+       size_t hop,
+       size_t historyLength,
+       Window window = Window::Hann);
+
+  /// consume interleaved samples, transforming each time another hop is complete
+  /// @return  number of frames emitted
+  size_t push(const T* samples, size_t count);
+
+  /// consume all samples a streaming capture (see DeviceCapture::start()) has available right now
+  /// @return  number of frames emitted
+  template<typename Capture>
+  size_t pull(Capture& capture);
+
+  /// power spectral density of frameSize / 2 + 1 bins [1/Hz], bin k at k * sampleRate / frameSize
+  /// @param age  0 for the most recent frame, up to size() - 1 for the oldest kept
+  const std::vector<T>& frame(size_t age = 0) const;
+
+  /// number of frames kept in history
+  size_t size() const;
+
+  /// total number of frames emitted
+  uint64_t frameCount() const;
+
+private:
+  void transform();
+
+private:
+  size_t hop_;
+  std::vector<T> weights_;
+  T scale_;
+  SpectrumAnalyzer<T> analyzer_;
+  std::vector<T> input_; ///< most recent frameSize mixed down samples
+  size_t inputFill_;
+  std::vector<T> segment_; ///< windowed copy of the input
+  std::vector<T> interleaved_; ///< read buffer for pull()
+  std::vector<std::vector<T>> history_; ///< ring of emitted frames
+  uint64_t frameCount_;
+};
+
+} // namespace audio
+
+#include "AudioSpectrum_impl.h"
+
+#endif // AUDIO_SPECTRUM_H
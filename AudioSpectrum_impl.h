@@ -0,0 +1,323 @@
+#ifndef AUDIO_SPECTRUM_IMPL_H
+#define AUDIO_SPECTRUM_IMPL_H
+
+#ifndef AUDIO_SPECTRUM_H
+#error "Include via AudioSpectrum.h"
+#endif // AUDIO_SPECTRUM_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+namespace audio {
+
+namespace detail {
+  static const size_t welchMinSegmentsPerThread = 4;
+
+  /// periodic window weights of the given size
+  template<typename T>
+  std::vector<T> windowWeights(Window window, size_t size)
+  {
+    std::vector<T> weights(size, T(1));
+    for(size_t i = 0; i < size; ++i) {
+      const double phase = 2 * M_PI * static_cast<double>(i) / static_cast<double>(size);
+      switch(window) {
+      case Window::Rectangular:
+        break;
+      case Window::Hann:
+        weights[i] = static_cast<T>(0.5 - 0.5 * std::cos(phase));
+        break;
+      case Window::Blackman:
+        weights[i] = static_cast<T>(0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2 * phase));
+        break;
+      }
+    }
+    return weights;
+  }
+
+  /// add the one-sided power of transformed bins to dst of bins.size() + 1 elements,
+  /// unpacking DC and Nyquist from the first bin
+  template<typename Complex, typename Destination>
+  void addPower(const std::vector<Complex>& bins, Destination& dst)
+  {
+    using D = typename Destination::value_type;
+
+    dst.front() += static_cast<D>(bins.front().real()) * static_cast<D>(bins.front().real());
+    dst.back() += static_cast<D>(bins.front().imag()) * static_cast<D>(bins.front().imag());
+    for(size_t k = 1; k < bins.size(); ++k) {
+      dst[k] += 2 * static_cast<D>(std::norm(bins[k]));
+    }
+  }
+
+  /// power normalization to spectral density
+  inline double densityScale(double windowPower, int sampleRate)
+  {
+    return 1.0 / (windowPower * sampleRate);
+  }
+
+  template<typename T>
+  double windowPower(const std::vector<T>& weights)
+  {
+    return std::inner_product(std::begin(weights), std::end(weights), std::begin(weights), 0.0);
+  }
+} // namespace detail
+
+template<typename T>
+const std::vector<typename SpectrumAnalyzer<T>::Complex>& SpectrumAnalyzer<T>::transform(const T* samples, size_t blockSize)
+{
+  assert(blockSize % 2 == 0);
+
+  transformed_.resize(blockSize / 2);
+  plan(blockSize / 2).transform_real(samples, transformed_.data());
+  return transformed_;
+}
+
+template<typename T>
+template<typename Source>
+const std::vector<typename SpectrumAnalyzer<T>::Complex>& SpectrumAnalyzer<T>::transformSum(const Source& source, size_t blockSize)
+{
+  sum_.assign(blockSize / 2, Complex());
+  block_.resize(blockSize);
+
+  const auto blockDistance = static_cast<std::ptrdiff_t>(blockSize);
+  for(auto first = std::begin(source); std::end(source) - first >= blockDistance; first += blockDistance) {
+    (void)std::copy(first, first + blockDistance, std::begin(block_));
+
+    const auto& transformed = transform(block_.data(), blockSize);
+    (void)std::transform(
+          std::begin(transformed), std::end(transformed),
+          std::begin(sum_), std::begin(sum_),
+          std::plus<Complex>());
+  }
+
+  return sum_;
+}
+
+template<typename T>
+const std::vector<T>& SpectrumAnalyzer<T>::correlate(
+    const T* signal,
+    size_t signalSize,
+    const T* reference,
+    size_t referenceSize)
+{
+  // zero-pad to a power of two that keeps the circular correlation from wrapping
+  size_t nfft = 1;
+  while(nfft < signalSize + referenceSize) {
+    nfft *= 2;
+  }
+
+  auto transformPadded = [&](const T* samples, size_t size, std::vector<Complex>& spectrum) {
+    padded_.assign(nfft, Complex());
+    (void)std::copy(samples, samples + size, std::begin(padded_));
+    spectrum.resize(nfft);
+    plan(nfft).transform(padded_.data(), spectrum.data());
+  };
+  transformPadded(signal, signalSize, signalSpectrum_);
+  transformPadded(reference, referenceSize, referenceSpectrum_);
+
+  // correlation is the inverse transform of the cross-spectrum
+  for(size_t k = 0; k < nfft; ++k) {
+    padded_[k] = signalSpectrum_[k] * std::conj(referenceSpectrum_[k]);
+  }
+  plan(nfft, true).transform(padded_.data(), signalSpectrum_.data());
+
+  const auto scale = T(1) / static_cast<T>(nfft);
+  correlation_.resize(signalSize);
+  for(size_t lag = 0; lag < signalSize; ++lag) {
+    correlation_[lag] = signalSpectrum_[lag].real() * scale;
+  }
+  return correlation_;
+}
+
+template<typename T>
+const typename SpectrumAnalyzer<T>::Plan& SpectrumAnalyzer<T>::plan(size_t nfft, bool isInverse)
+{
+  auto&& plan = plans_[std::make_pair(nfft, isInverse)];
+  if(!plan) {
+    plan.reset(new Plan(nfft, isInverse));
+  }
+  return *plan;
+}
+
+template<typename Source>
+std::vector<typename std::remove_const<typename Source::value_type>::type> welch(
+    const Source& source,
+    size_t segmentSize,
+    size_t hop,
+    Window window)
+{
+  using T = typename std::remove_const<typename Source::value_type>::type;
+
+  if(segmentSize == 0 || segmentSize % 2 != 0 || hop == 0) {
+    throw std::runtime_error("Invalid Welch segmentation");
+  }
+
+  const auto binCount = segmentSize / 2 + 1;
+  const auto size = source.size();
+  const auto segmentCount = (size < segmentSize ? 0 : (size - segmentSize) / hop + 1);
+  if(segmentCount == 0) {
+    return std::vector<T>(binCount);
+  }
+
+  const auto weights = detail::windowWeights<T>(window, segmentSize);
+  const auto threadCount = std::max<size_t>(1, std::min<size_t>(
+    std::thread::hardware_concurrency(),
+    segmentCount / detail::welchMinSegmentsPerThread));
+
+  // sum of squared magnitudes per thread, merged once all segments are done
+  std::vector<std::vector<double>> accumulators(threadCount, std::vector<double>(binCount));
+  auto accumulate = [&](size_t t) {
+    SpectrumAnalyzer<T> analyzer;
+    std::vector<T> segment(segmentSize);
+    auto&& accumulator = accumulators[t];
+
+    const auto segmentDistance = static_cast<std::ptrdiff_t>(segmentSize);
+    for(auto s = segmentCount * t / threadCount; s < segmentCount * (t + 1) / threadCount; ++s) {
+      const auto first = std::begin(source) + static_cast<std::ptrdiff_t>(s * hop);
+      (void)std::transform(
+            first, first + segmentDistance,
+            std::begin(weights), std::begin(segment),
+            std::multiplies<T>());
+
+      detail::addPower(analyzer.transform(segment.data(), segmentSize), accumulator);
+    }
+  };
+
+  std::vector<std::future<void>> workers;
+  for(size_t t = 1; t < threadCount; ++t) {
+    workers.push_back(std::async(std::launch::async, accumulate, t));
+  }
+  accumulate(0);
+
+  for(auto&& worker : workers) {
+    worker.get();
+  }
+
+  // normalize by segment count, window power and sample rate
+  const auto scale = detail::densityScale(detail::windowPower(weights), source.metadata.sampleRate)
+    / static_cast<double>(segmentCount);
+
+  std::vector<T> density(binCount);
+  for(size_t k = 0; k < binCount; ++k) {
+    double sum = 0.0;
+    for(auto&& accumulator : accumulators) {
+      sum += accumulator[k];
+    }
+    density[k] = static_cast<T>(sum * scale);
+  }
+
+  return density;
+}
+
+template<typename T>
+Stft<T>::Stft(
+    const Metadata& metadata,
+    size_t frameSize,
+    size_t hop,
+    size_t historyLength,
+    Window window)
+  : metadata(metadata)
+  , hop_(hop)
+  , weights_(detail::windowWeights<T>(window, frameSize))
+  , scale_(static_cast<T>(detail::densityScale(detail::windowPower(weights_), metadata.sampleRate)))
+  , input_(frameSize)
+  , inputFill_(0)
+  , segment_(frameSize)
+  , interleaved_(hop * metadata.channelCount)
+  , history_(historyLength, std::vector<T>(frameSize / 2 + 1))
+  , frameCount_(0)
+{
+  if(frameSize == 0 || frameSize % 2 != 0 || hop == 0 || hop > frameSize || historyLength == 0) {
+    throw std::runtime_error("Invalid STFT segmentation");
+  }
+
+  // warm up the plan cache and scratch buffers
+  (void)analyzer_.transform(segment_.data(), frameSize);
+}
+
+template<typename T>
+size_t Stft<T>::push(const T* samples, size_t count)
+{
+  const auto channelCount = metadata.channelCount;
+  const auto frameSize = input_.size();
+  const auto previousFrameCount = frameCount_;
+
+  for(auto last = samples + count / channelCount * channelCount; samples != last; samples += channelCount) {
+    T mixed = samples[0];
+    for(uint8_t c = 1; c < channelCount; ++c) {
+      mixed += samples[c];
+    }
+    input_[inputFill_++] = mixed / static_cast<T>(channelCount);
+
+    if(inputFill_ == frameSize) {
+      transform();
+
+      // keep the overlap for the next frame
+      (void)std::copy(std::begin(input_) + static_cast<std::ptrdiff_t>(hop_), std::end(input_), std::begin(input_));
+      inputFill_ -= hop_;
+    }
+  }
+
+  return static_cast<size_t>(frameCount_ - previousFrameCount);
+}
+
+template<typename T>
+template<typename Capture>
+size_t Stft<T>::pull(Capture& capture)
+{
+  size_t emitted = 0;
+  for(;;) {
+    const auto count = capture.tryRead(interleaved_.data(), interleaved_.size());
+    emitted += push(interleaved_.data(), count);
+    if(count < interleaved_.size()) {
+      return emitted;
+    }
+  }
+}
+
+template<typename T>
+const std::vector<T>& Stft<T>::frame(size_t age) const
+{
+  assert(age < size());
+  return history_[(frameCount_ - 1 - age) % history_.size()];
+}
+
+template<typename T>
+size_t Stft<T>::size() const
+{
+  return static_cast<size_t>(std::min<uint64_t>(frameCount_, history_.size()));
+}
+
+template<typename T>
+uint64_t Stft<T>::frameCount() const
+{
+  return frameCount_;
+}
+
+template<typename T>
+void Stft<T>::transform()
+{
+  (void)std::transform(
+        std::begin(input_), std::end(input_),
+        std::begin(weights_), std::begin(segment_),
+        std::multiplies<T>());
+
+  auto&& density = history_[frameCount_ % history_.size()];
+  std::fill(std::begin(density), std::end(density), T(0));
+  detail::addPower(analyzer_.transform(segment_.data(), segment_.size()), density);
+  for(auto&& v : density) {
+    v *= scale_;
+  }
+
+  ++frameCount_;
+}
+
+} // namespace audio
+
+#endif // AUDIO_SPECTRUM_IMPL_H
@@ -0,0 +1,59 @@
+#include "AudioSpill.h"
+
+#include <stdexcept>
+
+namespace audio {
+
+namespace {
+  int seek(std::FILE* file, uint64_t offset)
+  {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif // _WIN32
+  }
+} // namespace
+
+TempFile::TempFile()
+  : file_(std::tmpfile())
+  , buffer_(detail::tempFileBufferSize)
+  , position_(0)
+  , isReading_(false)
+{
+  if(file_ == nullptr) {
+    throw std::runtime_error("Failed to create temporary file");
+  }
+  (void)std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+}
+
+TempFile::~TempFile()
+{
+  (void)std::fclose(file_);
+}
+
+void TempFile::write(uint64_t offset, const void* data, size_t size)
+{
+  if((isReading_ || offset != position_) && seek(file_, offset) != 0) {
+    throw std::runtime_error("Failed to seek temporary file");
+  }
+  if(std::fwrite(data, 1, size, file_) != size) {
+    throw std::runtime_error("Failed to write temporary file");
+  }
+  position_ = offset + size;
+  isReading_ = false;
+}
+
+void TempFile::read(uint64_t offset, void* data, size_t size)
+{
+  if((!isReading_ || offset != position_) && seek(file_, offset) != 0) {
+    throw std::runtime_error("Failed to seek temporary file");
+  }
+  if(std::fread(data, 1, size, file_) != size) {
+    throw std::runtime_error("Failed to read temporary file");
+  }
+  position_ = offset + size;
+  isReading_ = true;
+}
+
+} // namespace audio
@@ -0,0 +1,146 @@
+#ifndef AUDIO_SPILL_H
+#define AUDIO_SPILL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace audio {
+
+namespace detail {
+  static const size_t spillCacheCount = 8; // spilled groups kept in memory once paged in
+  static const size_t tempFileBufferSize = 1 << 20; // bytes gathered before each write to disk
+} // namespace detail
+
+/// anonymous temporary file, deleted once closed
+struct TempFile
+{
+  /// @throw  std::runtime_error if no temporary file can be created
+  TempFile();
+  TempFile(const TempFile&) = delete;
+  TempFile(TempFile&&) = delete;
+  ~TempFile();
+
+  /// @throw  std::runtime_error on I/O errors
+  void write(uint64_t offset, const void* data, size_t size);
+  void read(uint64_t offset, void* data, size_t size);
+
+private:
+  std::FILE* file_;
+  std::vector<char> buffer_; ///< stdio buffer coalescing consecutive writes
+  uint64_t position_; ///< current file position, seeking flushes the buffer
+  bool isReading_; ///< direction of the last access, switching requires a seek
+};
+
+/// capture groups of uniform size paged out to a temporary file,
+/// with a small cache of groups paged back in
+template<typename T>
+struct SpillFile
+{
+  using Samples = std::vector<T>;
+
+  /// @param groupSize  number of samples in each group
+  /// @param cacheCount  number of groups kept in memory after paging them in
+  SpillFile(size_t groupSize, size_t cacheCount = detail::spillCacheCount);
+  SpillFile(const SpillFile&) = delete;
+  SpillFile(SpillFile&&) = delete;
+
+  /// append complete groups in one sequential write
+  /// @return  slot of the first appended group
+  template<typename FwdIt>
+  size_t append(FwdIt first, FwdIt last);
+
+  /// samples of the group stored in the given slot, paged in unless cached
+  /// @note  the samples stay valid as long as the returned pointer is held, even once evicted from the cache
+  std::shared_ptr<const Samples> load(size_t slot);
+
+  /// overwrite the group stored in the given slot; readers still holding it keep the previous samples
+  /// @note  only while no other sequence can read the slot
+  void store(size_t slot, const Samples& samples);
+
+  /// number of groups stored
+  size_t size() const;
+
+private:
+  struct Page
+  {
+    size_t slot;
+    std::shared_ptr<Samples> samples;
+  };
+
+  TempFile file_;
+  size_t groupSize_;
+  size_t cacheCount_;
+  size_t slotCount_;
+  std::deque<Page> cache_; ///< paged in groups, least recently paged in first
+  mutable std::mutex mutex_; ///< guards the file and cache against concurrent readers
+};
+
+/// leading capture groups of a Sequence living in a spill file instead of its page table;
+/// groups written to are paged in through a small private cache and written back once evicted,
+/// in place unless a copy shares the file, so copies stay independent and memory stays bounded
+template<typename T>
+struct Spilled
+{
+  using Samples = std::vector<T>;
+
+  Spilled() = default;
+  Spilled(const Spilled& other);
+  Spilled(Spilled&& other);
+  Spilled& operator=(const Spilled& other);
+  Spilled& operator=(Spilled&& other);
+
+  /// number of spilled groups
+  /// @note  does not lock, the count only changes along with the sequence
+  size_t count() const;
+
+  /// samples of a spilled group for reading
+  /// @note  the samples stay valid as long as the returned pointer is held
+  std::shared_ptr<const Samples> load(size_t index) const;
+
+  /// samples of a spilled group for writing
+  /// @note  the samples are written back once cacheCount further groups were written to,
+  ///        unless the returned pointer is still held then
+  std::shared_ptr<Samples> modify(size_t index);
+
+  /// remove and return the first spilled group
+  Samples pop();
+
+  /// keep the first count groups only
+  void truncate(size_t count);
+
+  /// page out complete groups behind the spilled ones in one sequential write,
+  /// together with the groups written to since they were paged in
+  template<typename FwdIt>
+  void append(FwdIt first, FwdIt last, size_t groupSize, size_t cacheCount);
+
+private:
+  struct Page
+  {
+    size_t index; ///< group index counted from the first group ever spilled, stable across pop()
+    std::shared_ptr<Samples> samples;
+  };
+
+  /// write back and drop cached groups no one holds, down to the given number of cached groups
+  /// @note  requires the mutex to be held
+  void evict(size_t pageCount);
+
+private:
+  std::shared_ptr<SpillFile<T>> file_; ///< shared by copies, only written to in place while not shared
+  std::deque<size_t> slots_; ///< file slot of each spilled group
+  size_t count_ = 0; ///< size of slots_, cached for access to resident groups
+  size_t popped_ = 0; ///< number of groups removed from the front
+  std::deque<Page> pages_; ///< groups written to, least recently accessed first
+  size_t cacheCount_ = detail::spillCacheCount;
+  mutable std::mutex mutex_; ///< guards the file slots and cached groups against concurrent access
+};
+
+} // namespace audio
+
+#include "AudioSpill_impl.h"
+
+#endif // AUDIO_SPILL_H
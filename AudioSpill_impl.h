@@ -0,0 +1,268 @@
+#ifndef AUDIO_SPILL_IMPL_H
+#define AUDIO_SPILL_IMPL_H
+
+#ifndef AUDIO_SPILL_H
+#error "Include via AudioSpill.h"
+#endif // AUDIO_SPILL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <utility>
+
+namespace audio {
+
+template<typename T>
+SpillFile<T>::SpillFile(size_t groupSize, size_t cacheCount)
+  : groupSize_(groupSize)
+  , cacheCount_(std::max<size_t>(1, cacheCount))
+  , slotCount_(0)
+{
+}
+
+template<typename T>
+template<typename FwdIt>
+size_t SpillFile<T>::append(FwdIt first, FwdIt last)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // consecutive writes are gathered by the file buffer into large sequential ones
+  const auto firstSlot = slotCount_;
+  for(; first != last; ++first) {
+    assert(first->size() == groupSize_);
+    file_.write(static_cast<uint64_t>(slotCount_) * groupSize_ * sizeof(T), first->data(), groupSize_ * sizeof(T));
+    ++slotCount_;
+  }
+  return firstSlot;
+}
+
+
+template<typename T>
+std::shared_ptr<const typename SpillFile<T>::Samples> SpillFile<T>::load(size_t slot)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(slot < slotCount_);
+
+  // sequential access hits the most recent page
+  for(auto page = cache_.rbegin(); page != cache_.rend(); ++page) {
+    if(page->slot == slot) {
+      return page->samples;
+    }
+  }
+
+  // evicted pages are freed once the last reader releases them, so each page in gets a fresh buffer
+  if(cache_.size() >= cacheCount_) {
+    cache_.pop_front();
+  }
+  const auto samples = std::make_shared<Samples>(groupSize_);
+  file_.read(static_cast<uint64_t>(slot) * groupSize_ * sizeof(T), samples->data(), groupSize_ * sizeof(T));
+  cache_.push_back(Page{slot, samples});
+  return samples;
+}
+
+template<typename T>
+void SpillFile<T>::store(size_t slot, const Samples& samples)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(slot < slotCount_ && samples.size() == groupSize_);
+
+  file_.write(static_cast<uint64_t>(slot) * groupSize_ * sizeof(T), samples.data(), groupSize_ * sizeof(T));
+  (void)cache_.erase(
+        std::remove_if(std::begin(cache_), std::end(cache_), [slot](const Page& page) { return page.slot == slot; }),
+        std::end(cache_));
+}
+
+template<typename T>
+size_t SpillFile<T>::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slotCount_;
+}
+
+
+template<typename T>
+Spilled<T>::Spilled(const Spilled& other)
+{
+  std::lock_guard<std::mutex> lock(other.mutex_);
+  file_ = other.file_;
+  slots_ = other.slots_;
+  count_ = other.count_;
+  popped_ = other.popped_;
+  cacheCount_ = other.cacheCount_;
+
+  // groups written to are private to each copy
+  for(auto&& page : other.pages_) {
+    pages_.push_back(Page{page.index, std::make_shared<Samples>(*page.samples)});
+  }
+}
+
+template<typename T>
+Spilled<T>::Spilled(Spilled&& other)
+  : file_(std::move(other.file_))
+  , slots_(std::move(other.slots_))
+  , count_(other.count_)
+  , popped_(other.popped_)
+  , pages_(std::move(other.pages_))
+  , cacheCount_(other.cacheCount_)
+{
+  other.slots_.clear();
+  other.count_ = 0;
+}
+
+template<typename T>
+Spilled<T>& Spilled<T>::operator=(const Spilled& other)
+{
+  if(this != &other) {
+    Spilled copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+template<typename T>
+Spilled<T>& Spilled<T>::operator=(Spilled&& other)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_ = std::move(other.file_);
+  slots_ = std::move(other.slots_);
+  count_ = other.count_;
+  popped_ = other.popped_;
+  pages_ = std::move(other.pages_);
+  cacheCount_ = other.cacheCount_;
+  other.slots_.clear();
+  other.count_ = 0;
+  return *this;
+}
+
+template<typename T>
+size_t Spilled<T>::count() const
+{
+  return count_;
+}
+
+template<typename T>
+std::shared_ptr<const typename Spilled<T>::Samples> Spilled<T>::load(size_t index) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(index < slots_.size());
+
+  for(auto&& page : pages_) {
+    if(page.index == popped_ + index) {
+      return page.samples;
+    }
+  }
+  return file_->load(slots_[index]);
+}
+
+template<typename T>
+std::shared_ptr<typename Spilled<T>::Samples> Spilled<T>::modify(size_t index)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(index < slots_.size());
+
+  // sequential access hits the most recent page, any other hit becomes the most recent one
+  for(auto page = pages_.rbegin(); page != pages_.rend(); ++page) {
+    if(page->index == popped_ + index) {
+      if(page != pages_.rbegin()) {
+        auto hit = std::move(*page);
+        (void)pages_.erase(std::next(page).base());
+        pages_.push_back(std::move(hit));
+      }
+      return pages_.back().samples;
+    }
+  }
+
+  evict(cacheCount_ - 1);
+  pages_.push_back(Page{popped_ + index, std::make_shared<Samples>(*file_->load(slots_[index]))});
+  return pages_.back().samples;
+}
+
+template<typename T>
+typename Spilled<T>::Samples Spilled<T>::pop()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(!slots_.empty());
+
+  Samples ret;
+  const auto page = std::find_if(std::begin(pages_), std::end(pages_), [this](const Page& p) { return p.index == popped_; });
+  if(page != std::end(pages_)) {
+    ret = *page->samples;
+    (void)pages_.erase(page);
+  } else {
+    ret = *file_->load(slots_.front());
+  }
+  slots_.pop_front();
+  count_ = slots_.size();
+  ++popped_;
+
+  // the file is deleted once no copy refers to it anymore
+  if(slots_.empty()) {
+    file_.reset();
+  }
+  return ret;
+}
+
+template<typename T>
+void Spilled<T>::truncate(size_t count)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // dropped slots stay in the file, copies may still read them
+  count = std::min(count, slots_.size());
+  (void)pages_.erase(
+        std::remove_if(std::begin(pages_), std::end(pages_), [this, count](const Page& page) { return page.index >= popped_ + count; }),
+        std::end(pages_));
+  slots_.resize(count);
+  count_ = count;
+  if(slots_.empty()) {
+    file_.reset();
+  }
+}
+
+template<typename T>
+template<typename FwdIt>
+void Spilled<T>::append(FwdIt first, FwdIt last, size_t groupSize, size_t cacheCount)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if(!file_) {
+    file_ = std::make_shared<SpillFile<T>>(groupSize, cacheCount);
+  }
+  // at least two, so a group written to stays paged in while the next one is accessed, e.g. for seq[i] = seq[j]
+  cacheCount_ = std::max<size_t>(2, cacheCount);
+  evict(0);
+
+  for(auto slot = file_->append(first, last); first != last; ++first) {
+    slots_.push_back(slot++);
+  }
+  count_ = slots_.size();
+}
+
+template<typename T>
+void Spilled<T>::evict(size_t pageCount)
+{
+  for(auto page = std::begin(pages_); page != std::end(pages_) && pages_.size() > pageCount;) {
+    // groups still held for writing stay cached, so no write goes astray
+    if(page->samples.use_count() > 1) {
+      ++page;
+      continue;
+    }
+
+    // make the writes of the last holder visible, which released the page after writing
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // the original slot is overwritten unless a copy may still read it
+    auto&& slot = slots_[page->index - popped_];
+    if(file_.use_count() == 1) {
+      file_->store(slot, *page->samples);
+    } else {
+      const auto samples = page->samples.get();
+      slot = file_->append(samples, samples + 1);
+    }
+    page = pages_.erase(page);
+  }
+}
+
+} // namespace audio
+
+#endif // AUDIO_SPILL_IMPL_H
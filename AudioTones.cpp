@@ -0,0 +1,125 @@
+#include "AudioTones.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define AUDIO_TONES_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define AUDIO_TONES_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+namespace {
+  const size_t laneCount = 4;
+} // namespace
+
+ToneDetector::ToneDetector(const Metadata& metadata, std::vector<float> frequencies, size_t blockSize)
+  : metadata(metadata)
+  , frequencies_(std::move(frequencies))
+  , blockSize_(blockSize)
+  , blockFill_(0)
+  , blockCount_(0)
+  , coeffs_((frequencies_.size() + laneCount - 1) / laneCount * laneCount)
+  , s1_(coeffs_.size())
+  , s2_(coeffs_.size())
+  , amplitudes_(frequencies_.size())
+  , scratch_(blockSize * (1 + metadata.channelCount))
+{
+  if(blockSize == 0 || frequencies_.empty()) {
+    throw std::runtime_error("Invalid tone detector settings");
+  }
+
+  for(size_t t = 0; t < frequencies_.size(); ++t) {
+    coeffs_[t] = static_cast<float>(2 * std::cos(2 * M_PI * frequencies_[t] / metadata.sampleRate));
+  }
+}
+
+size_t ToneDetector::push(const float* samples, size_t count)
+{
+  return push(samples, count, [](const std::vector<float>&) {});
+}
+
+const std::vector<float>& ToneDetector::frequencies() const
+{
+  return frequencies_;
+}
+
+const std::vector<float>& ToneDetector::amplitudes() const
+{
+  return amplitudes_;
+}
+
+uint64_t ToneDetector::blockCount() const
+{
+  return blockCount_;
+}
+
+void ToneDetector::feed(const float* samples, size_t count)
+{
+  // s0 = x + coeff * s1 - s2, for four filters at once
+  size_t t = 0;
+#if defined(AUDIO_TONES_SSE2)
+  for(; t < coeffs_.size(); t += laneCount) {
+    const auto coeff = _mm_loadu_ps(coeffs_.data() + t);
+    auto s1 = _mm_loadu_ps(s1_.data() + t);
+    auto s2 = _mm_loadu_ps(s2_.data() + t);
+    for(size_t i = 0; i < count; ++i) {
+      const auto s0 = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(samples[i]), _mm_mul_ps(coeff, s1)), s2);
+      s2 = s1;
+      s1 = s0;
+    }
+    _mm_storeu_ps(s1_.data() + t, s1);
+    _mm_storeu_ps(s2_.data() + t, s2);
+  }
+#endif
+#if defined(AUDIO_TONES_NEON)
+  for(; t < coeffs_.size(); t += laneCount) {
+    const auto coeff = vld1q_f32(coeffs_.data() + t);
+    auto s1 = vld1q_f32(s1_.data() + t);
+    auto s2 = vld1q_f32(s2_.data() + t);
+    for(size_t i = 0; i < count; ++i) {
+      const auto s0 = vsubq_f32(vmlaq_f32(vdupq_n_f32(samples[i]), coeff, s1), s2);
+      s2 = s1;
+      s1 = s0;
+    }
+    vst1q_f32(s1_.data() + t, s1);
+    vst1q_f32(s2_.data() + t, s2);
+  }
+#endif
+  for(; t < coeffs_.size(); ++t) {
+    const auto coeff = coeffs_[t];
+    auto s1 = s1_[t];
+    auto s2 = s2_[t];
+    for(size_t i = 0; i < count; ++i) {
+      const auto s0 = samples[i] + coeff * s1 - s2;
+      s2 = s1;
+      s1 = s0;
+    }
+    s1_[t] = s1;
+    s2_[t] = s2;
+  }
+
+  blockFill_ += count;
+}
+
+void ToneDetector::finishBlock()
+{
+  // |X|^2 = s1^2 + s2^2 - coeff * s1 * s2; a sine of amplitude A yields |X| = A * N / 2
+  const auto scale = 2.f / static_cast<float>(blockSize_);
+  for(size_t t = 0; t < amplitudes_.size(); ++t) {
+    const auto power = s1_[t] * s1_[t] + s2_[t] * s2_[t] - coeffs_[t] * s1_[t] * s2_[t];
+    amplitudes_[t] = scale * std::sqrt(std::max(power, 0.f));
+  }
+
+  std::fill(std::begin(s1_), std::end(s1_), 0.f);
+  std::fill(std::begin(s2_), std::end(s2_), 0.f);
+  blockFill_ = 0;
+  ++blockCount_;
+}
+
+} // namespace audio
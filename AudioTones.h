@@ -0,0 +1,116 @@
+#ifndef AUDIO_TONES_H
+#define AUDIO_TONES_H
+
+#include "AudioSequence.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/// bank of Goertzel filters watching a set of known frequencies,
+/// reporting each tone's amplitude per block of samples at O(tones) cost per sample
+/// @note  channels are mixed down; the filters run across tones with SSE2/NEON as enabled for the build
+struct ToneDetector
+{
+  Metadata metadata; ///< layout of the consumed stream
+
+  /// @param frequencies  tones to watch [Hz]
+  /// @param blockSize  number of samples (per channel) per evaluation; longer blocks separate closer tones
+  ToneDetector(const Metadata& metadata, std::vector<float> frequencies, size_t blockSize);
+
+  /// consume interleaved samples, calling onBlock(amplitudes()) for every completed block
+  /// @return  number of blocks completed
+  template<typename Handler>
+  size_t push(const float* samples, size_t count, Handler&& onBlock);
+  size_t push(const float* samples, size_t count);
+
+  /// consume all samples a streaming capture (see DeviceCapture::start()) has available right now
+  /// @return  number of blocks completed
+  template<typename Capture, typename Handler>
+  size_t pull(Capture& capture, Handler&& onBlock);
+
+  /// watched tones [Hz]
+  const std::vector<float>& frequencies() const;
+
+  /// amplitude of each watched tone over the last completed block, 1 for a full scale sine
+  const std::vector<float>& amplitudes() const;
+
+  /// total number of blocks completed
+  uint64_t blockCount() const;
+
+private:
+  /// run the filters over mono samples not exceeding the current block
+  void feed(const float* samples, size_t count);
+
+  /// evaluate and reset the filters
+  void finishBlock();
+
+private:
+  std::vector<float> frequencies_;
+  size_t blockSize_;
+  size_t blockFill_;
+  uint64_t blockCount_;
+  std::vector<float> coeffs_; ///< per filter, padded to the vector width
+  std::vector<float> s1_; ///< previous filter state
+  std::vector<float> s2_; ///< filter state before the previous one
+  std::vector<float> amplitudes_;
+  std::vector<float> scratch_; ///< mixed down or pulled samples
+};
+
+template<typename Handler>
+size_t ToneDetector::push(const float* samples, size_t count, Handler&& onBlock)
+{
+  const size_t channelCount = metadata.channelCount;
+
+  size_t blocks = 0;
+  for(auto last = samples + count / channelCount * channelCount; samples != last;) {
+    // up to the end of the current block
+    const auto frames = std::min(static_cast<size_t>(last - samples) / channelCount, blockSize_ - blockFill_);
+
+    if(channelCount == 1) {
+      feed(samples, frames);
+    } else {
+      for(size_t f = 0; f < frames; ++f) {
+        float mixed = 0.f;
+        for(size_t c = 0; c < channelCount; ++c) {
+          mixed += samples[f * channelCount + c];
+        }
+        scratch_[f] = mixed / static_cast<float>(channelCount);
+      }
+      feed(scratch_.data(), frames);
+    }
+    samples += frames * channelCount;
+
+    if(blockFill_ == blockSize_) {
+      finishBlock();
+      ++blocks;
+      onBlock(amplitudes_);
+    }
+  }
+
+  return blocks;
+}
+
+template<typename Capture, typename Handler>
+size_t ToneDetector::pull(Capture& capture, Handler&& onBlock)
+{
+  // read into the back half of the scratch buffer, leaving the front for mixing down
+  const auto readSize = blockSize_ * metadata.channelCount;
+  const auto read = scratch_.data() + blockSize_;
+
+  size_t blocks = 0;
+  for(;;) {
+    const auto count = capture.tryRead(read, readSize);
+    blocks += push(read, count, onBlock);
+    if(count < readSize) {
+      return blocks;
+    }
+  }
+}
+
+} // namespace audio
+
+#endif // AUDIO_TONES_H
@@ -0,0 +1,154 @@
+#ifndef AUDIO_VIEW_H
+#define AUDIO_VIEW_H
+
+#include "AudioSequence.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace audio {
+
+namespace detail {
+  struct ViewBase {};
+
+  /// composed views copy their (cheap) source views, sequences are borrowed
+  template<typename Source>
+  using SourceHolder = typename std::conditional<
+    std::is_base_of<ViewBase, Source>::value,
+    const Source,
+    const Source&>::type;
+
+  template<typename Source>
+  struct Reverse;
+  template<typename Source>
+  struct ReverseGroups;
+  template<typename Source>
+  struct ReverseWithinGroups;
+  template<typename Source>
+  struct Slice;
+  template<typename Source>
+  struct Stride;
+  template<typename Source>
+  struct Channel;
+  template<typename First, typename Second>
+  struct Concat;
+} // namespace detail
+
+template<typename Mapping>
+struct ViewIterator;
+
+/// lazy read-only view on samples of a Sequence or another view
+/// @note  the viewed Sequence is borrowed and has to outlive the view
+/// @note  views address samples in storage order; reversal and concatenation keep the channels of planar groups apart,
+///        for slicing and striding select a channel of multi-channel sequences first
+template<typename Mapping>
+struct View : detail::ViewBase
+{
+  using value_type = typename Mapping::value_type;
+  using iterator = ViewIterator<Mapping>;
+  using const_iterator = ViewIterator<Mapping>;
+
+  Metadata metadata; ///< metadata of the viewed samples
+  Mapping mapping; ///< index transformation onto the viewed source
+
+  View(const Metadata& metadata, Mapping mapping);
+
+  /// determine playback length of all samples in view
+  std::chrono::milliseconds duration() const;
+
+  value_type operator[](size_t pos) const;
+
+  size_t size() const;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+};
+
+/// random access iterator over a view, yielding samples by value
+template<typename Mapping>
+struct ViewIterator
+{
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = typename Mapping::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const value_type*;
+  using reference = value_type;
+
+  ViewIterator();
+  ViewIterator(const View<Mapping>* view, size_t pos);
+
+  reference operator*() const;
+  reference operator[](difference_type n) const;
+
+  ViewIterator& operator++();
+  ViewIterator& operator--();
+
+  ViewIterator operator++(int);
+  ViewIterator operator--(int);
+
+  ViewIterator& operator+=(difference_type n);
+  ViewIterator& operator-=(difference_type n);
+
+  ViewIterator operator+(difference_type n) const;
+  ViewIterator operator-(difference_type n) const;
+  difference_type operator-(const ViewIterator& other) const;
+
+  bool operator==(const ViewIterator& other) const;
+  bool operator!=(const ViewIterator& other) const;
+  bool operator<(const ViewIterator& other) const;
+  bool operator>(const ViewIterator& other) const;
+  bool operator<=(const ViewIterator& other) const;
+  bool operator>=(const ViewIterator& other) const;
+
+private:
+  const View<Mapping>* view_;
+  size_t pos_;
+};
+
+template<typename Mapping>
+ViewIterator<Mapping> operator+(typename ViewIterator<Mapping>::difference_type n, const ViewIterator<Mapping>& it);
+
+/// all samples in reverse order
+template<typename Source>
+View<detail::Reverse<Source>> reverse(const Source& source);
+
+/// capture groups in reverse order, samples within each group in original order
+template<typename Source>
+View<detail::ReverseGroups<Source>> reverseGroups(const Source& source);
+
+/// capture groups in original order, samples within each group in reverse order
+template<typename Source>
+View<detail::ReverseWithinGroups<Source>> reverseWithinGroups(const Source& source);
+
+/// samples in range [first, last)
+template<typename Source>
+View<detail::Slice<Source>> slice(const Source& source, size_t first, size_t last);
+
+/// every step-th sample starting at offset
+template<typename Source>
+View<detail::Stride<Source>> stride(const Source& source, size_t offset, size_t step);
+
+/// samples of one channel of planar multi-channel samples (as stored in a Sequence)
+template<typename Source>
+View<detail::Channel<Source>> channel(const Source& source, uint8_t index);
+
+/// samples of first followed by samples of second
+/// @throw  std::invalid_argument if the metadata of both differs
+template<typename First, typename Second>
+View<detail::Concat<First, Second>> concat(const First& first, const Second& second);
+
+/// copy viewed samples into a Sequence
+template<typename Mapping>
+Sequence<typename Mapping::value_type> materialize(const View<Mapping>& view);
+
+/// moving average of the viewed samples into a new Sequence
+template<typename Mapping>
+Sequence<typename Mapping::value_type> smooth(const View<Mapping>& view, size_t windowRadius);
+
+} // namespace audio
+
+#include "AudioView_impl.h"
+
+#endif // AUDIO_VIEW_H
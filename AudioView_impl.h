@@ -0,0 +1,430 @@
+#ifndef AUDIO_VIEW_IMPL_H
+#define AUDIO_VIEW_IMPL_H
+
+#ifndef AUDIO_VIEW_H
+#error "Include via AudioView.h"
+#endif // AUDIO_VIEW_H
+
+#include "Algo.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace audio {
+
+namespace detail {
+  template<typename Source>
+  struct Reverse
+  {
+    using value_type = typename Source::value_type;
+
+    SourceHolder<Source> source;
+
+    size_t size() const
+    {
+      return source.size();
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      // frames are reversed per channel, the planar layout of the groups is kept
+      const auto& metadata = source.metadata;
+      const auto size = source.size();
+      const auto position = planarPosition(metadata, size, pos);
+      const auto frameCount = size / metadata.channelCount;
+      return source[planarIndex(metadata, size, position.channel, frameCount - 1 - position.frame)];
+    }
+  };
+
+  template<typename Source>
+  struct ReverseGroups
+  {
+    using value_type = typename Source::value_type;
+
+    SourceHolder<Source> source;
+
+    size_t size() const
+    {
+      return source.size();
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      const auto& metadata = source.metadata;
+      const auto size = source.size();
+      const auto position = planarPosition(metadata, size, pos);
+
+      // the (possibly shorter) last group of the source comes first
+      const size_t groupFrames = metadata.sampleCount;
+      const auto frameCount = size / metadata.channelCount;
+      const auto lastGroup = (frameCount - 1) / groupFrames;
+      const auto lastGroupFrames = frameCount - lastGroup * groupFrames;
+      auto frame = position.frame;
+      if(frame < lastGroupFrames) {
+        frame += lastGroup * groupFrames;
+      } else {
+        frame -= lastGroupFrames;
+        frame = (lastGroup - 1 - frame / groupFrames) * groupFrames + frame % groupFrames;
+      }
+      return source[planarIndex(metadata, size, position.channel, frame)];
+    }
+  };
+
+  template<typename Source>
+  struct ReverseWithinGroups
+  {
+    using value_type = typename Source::value_type;
+
+    SourceHolder<Source> source;
+
+    size_t size() const
+    {
+      return source.size();
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      // frames are reversed per channel within each group
+      const auto& metadata = source.metadata;
+      const auto size = source.size();
+      const auto position = planarPosition(metadata, size, pos);
+      const size_t groupFrames = metadata.sampleCount;
+      const auto groupFirst = position.frame - position.frame % groupFrames;
+      const auto groupLast = std::min(groupFirst + groupFrames, size / metadata.channelCount);
+      return source[planarIndex(metadata, size, position.channel, groupLast - 1 - (position.frame - groupFirst))];
+    }
+  };
+
+  template<typename Source>
+  struct Slice
+  {
+    using value_type = typename Source::value_type;
+
+    SourceHolder<Source> source;
+    size_t first;
+    size_t count;
+
+    size_t size() const
+    {
+      return count;
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      return source[first + pos];
+    }
+  };
+
+  template<typename Source>
+  struct Stride
+  {
+    using value_type = typename Source::value_type;
+
+    SourceHolder<Source> source;
+    size_t offset;
+    size_t step;
+
+    size_t size() const
+    {
+      const auto sourceSize = source.size();
+      return (sourceSize > offset ? (sourceSize - offset + step - 1) / step : 0);
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      return source[offset + pos * step];
+    }
+  };
+
+  template<typename Source>
+  struct Channel
+  {
+    using value_type = typename Source::value_type;
+
+    SourceHolder<Source> source;
+    uint8_t index;
+
+    size_t size() const
+    {
+      return source.size() / source.metadata.channelCount;
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      return source[planarIndex(source.metadata, source.size(), index, pos)];
+    }
+  };
+
+  template<typename First, typename Second>
+  struct Concat
+  {
+    using value_type = typename First::value_type;
+    static_assert(std::is_same<value_type, typename Second::value_type>::value,
+                  "Concatenated sample types differ");
+
+    SourceHolder<First> first;
+    SourceHolder<Second> second;
+
+    size_t size() const
+    {
+      return first.size() + second.size();
+    }
+
+    value_type operator[](size_t pos) const
+    {
+      // frames of second follow those of first per channel, regrouped into planar groups
+      const auto& metadata = first.metadata;
+      const auto firstSize = first.size();
+      const auto position = planarPosition(metadata, size(), pos);
+      const auto firstFrames = firstSize / metadata.channelCount;
+      if(position.frame < firstFrames) {
+        return first[planarIndex(metadata, firstSize, position.channel, position.frame)];
+      }
+      return second[planarIndex(metadata, second.size(), position.channel, position.frame - firstFrames)];
+    }
+  };
+} // namespace detail
+
+template<typename Mapping>
+View<Mapping>::View(const Metadata& metadata, Mapping mapping)
+  : metadata(metadata)
+  , mapping(std::move(mapping))
+{}
+
+template<typename Mapping>
+std::chrono::milliseconds View<Mapping>::duration() const
+{
+  assert(metadata.sampleRate > 0);
+  return std::chrono::milliseconds(static_cast<uint64_t>(size() / metadata.channelCount) * 1000 / metadata.sampleRate);
+}
+
+template<typename Mapping>
+typename View<Mapping>::value_type View<Mapping>::operator[](size_t pos) const
+{
+  return mapping[pos];
+}
+
+template<typename Mapping>
+size_t View<Mapping>::size() const
+{
+  return mapping.size();
+}
+
+template<typename Mapping>
+typename View<Mapping>::const_iterator View<Mapping>::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+template<typename Mapping>
+typename View<Mapping>::const_iterator View<Mapping>::end() const
+{
+  return const_iterator(this, size());
+}
+
+
+template<typename Mapping>
+ViewIterator<Mapping>::ViewIterator()
+  : view_(nullptr)
+  , pos_(0)
+{}
+
+template<typename Mapping>
+ViewIterator<Mapping>::ViewIterator(const View<Mapping>* view, size_t pos)
+  : view_(view)
+  , pos_(pos)
+{}
+
+template<typename Mapping>
+typename ViewIterator<Mapping>::reference ViewIterator<Mapping>::operator*() const
+{
+  return (*view_)[pos_];
+}
+
+template<typename Mapping>
+typename ViewIterator<Mapping>::reference ViewIterator<Mapping>::operator[](difference_type n) const
+{
+  return (*view_)[pos_ + n];
+}
+
+template<typename Mapping>
+ViewIterator<Mapping>& ViewIterator<Mapping>::operator++()
+{
+  ++pos_;
+  return *this;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping>& ViewIterator<Mapping>::operator--()
+{
+  --pos_;
+  return *this;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping> ViewIterator<Mapping>::operator++(int)
+{
+  auto tmp = *this;
+  ++pos_;
+  return tmp;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping> ViewIterator<Mapping>::operator--(int)
+{
+  auto tmp = *this;
+  --pos_;
+  return tmp;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping>& ViewIterator<Mapping>::operator+=(difference_type n)
+{
+  pos_ += n;
+  return *this;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping>& ViewIterator<Mapping>::operator-=(difference_type n)
+{
+  pos_ -= n;
+  return *this;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping> ViewIterator<Mapping>::operator+(difference_type n) const
+{
+  return ViewIterator(view_, pos_ + n);
+}
+
+template<typename Mapping>
+ViewIterator<Mapping> ViewIterator<Mapping>::operator-(difference_type n) const
+{
+  return ViewIterator(view_, pos_ - n);
+}
+
+template<typename Mapping>
+typename ViewIterator<Mapping>::difference_type ViewIterator<Mapping>::operator-(const ViewIterator& other) const
+{
+  return static_cast<difference_type>(pos_) - static_cast<difference_type>(other.pos_);
+}
+
+template<typename Mapping>
+bool ViewIterator<Mapping>::operator==(const ViewIterator& other) const
+{
+  return (view_ == other.view_) && (pos_ == other.pos_);
+}
+
+template<typename Mapping>
+bool ViewIterator<Mapping>::operator!=(const ViewIterator& other) const
+{
+  return !(*this == other);
+}
+
+template<typename Mapping>
+bool ViewIterator<Mapping>::operator<(const ViewIterator& other) const
+{
+  return pos_ < other.pos_;
+}
+
+template<typename Mapping>
+bool ViewIterator<Mapping>::operator>(const ViewIterator& other) const
+{
+  return pos_ > other.pos_;
+}
+
+template<typename Mapping>
+bool ViewIterator<Mapping>::operator<=(const ViewIterator& other) const
+{
+  return pos_ <= other.pos_;
+}
+
+template<typename Mapping>
+bool ViewIterator<Mapping>::operator>=(const ViewIterator& other) const
+{
+  return pos_ >= other.pos_;
+}
+
+template<typename Mapping>
+ViewIterator<Mapping> operator+(typename ViewIterator<Mapping>::difference_type n, const ViewIterator<Mapping>& it)
+{
+  return it + n;
+}
+
+
+template<typename Source>
+View<detail::Reverse<Source>> reverse(const Source& source)
+{
+  return {source.metadata, detail::Reverse<Source>{source}};
+}
+
+template<typename Source>
+View<detail::ReverseGroups<Source>> reverseGroups(const Source& source)
+{
+  return {source.metadata, detail::ReverseGroups<Source>{source}};
+}
+
+template<typename Source>
+View<detail::ReverseWithinGroups<Source>> reverseWithinGroups(const Source& source)
+{
+  return {source.metadata, detail::ReverseWithinGroups<Source>{source}};
+}
+
+template<typename Source>
+View<detail::Slice<Source>> slice(const Source& source, size_t first, size_t last)
+{
+  last = std::min(last, source.size());
+  first = std::min(first, last);
+  return {source.metadata, detail::Slice<Source>{source, first, last - first}};
+}
+
+template<typename Source>
+View<detail::Stride<Source>> stride(const Source& source, size_t offset, size_t step)
+{
+  assert(step > 0);
+  return {source.metadata, detail::Stride<Source>{source, offset, step}};
+}
+
+template<typename Source>
+View<detail::Channel<Source>> channel(const Source& source, uint8_t index)
+{
+  assert(index < source.metadata.channelCount);
+
+  auto metadata = source.metadata;
+  metadata.channelCount = 1;
+  return {metadata, detail::Channel<Source>{source, index}};
+}
+
+template<typename First, typename Second>
+View<detail::Concat<First, Second>> concat(const First& first, const Second& second)
+{
+  const auto& a = first.metadata;
+  const auto& b = second.metadata;
+  if((a.sampleRate != b.sampleRate) || (a.channelCount != b.channelCount) || (a.sampleCount != b.sampleCount)) {
+    throw std::invalid_argument("Cannot concatenate samples of different metadata");
+  }
+  return {first.metadata, detail::Concat<First, Second>{first, second}};
+}
+
+template<typename Mapping>
+Sequence<typename Mapping::value_type> materialize(const View<Mapping>& view)
+{
+  Sequence<typename Mapping::value_type> seq{view.metadata, {}, {}};
+  seq.resize(view.size());
+  (void)std::copy(std::begin(view), std::end(view), std::begin(seq));
+  return seq;
+}
+
+template<typename Mapping>
+Sequence<typename Mapping::value_type> smooth(const View<Mapping>& view, size_t windowRadius)
+{
+  Sequence<typename Mapping::value_type> smoothed{view.metadata, {}, {}};
+  smoothed.resize(view.size());
+  smooth(view, smoothed, windowRadius);
+  return smoothed;
+}
+
+} // namespace audio
+
+#endif // AUDIO_VIEW_IMPL_H
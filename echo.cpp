@@ -1,45 +1,64 @@
 #include "Algo.h"
 #include "AudioDevice.h"
+#include "AudioDuplex.h"
+#include "AudioEcho.h"
 
-#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <iterator>
 #include <iostream>
+#include <memory>
 
 namespace consts {
+  static const audio::Metadata metadata = {48000, 1, 1024};
+
+  static const std::chrono::milliseconds targetLatency(50);
+
+  static const uint32_t echoLengthMsec = 5000;
   static const uint32_t recordLengthMsec = 5000;
+
+  // a repeating slapback plus a sparser one at a fractional delay (21000.48 frames)
+  static const float echoMix = 0.4f;
+  static const audio::Echo::Tap echoTaps[] = {{250.0, 1.f, 0.45f}, {437.51, 0.6f, 0.2f}};
 } // namespace consts
 
 int main(int, char**)
 try {
-  audio::DeviceCapture<float> capture;
-  auto recording = capture.record(consts::recordLengthMsec);
+  const auto backend = audio::defaultBackend();
 
-  audio::DevicePlayback<float> playback(recording.metadata);
+  // live echo of the input, added in the playback callback
+  std::cout << "live echo" << std::endl;
+  {
+    audio::Duplex duplex(consts::metadata,
+                         consts::targetLatency,
+                         audio::Echo(consts::metadata,
+                                     {std::begin(consts::echoTaps), std::end(consts::echoTaps)},
+                                     consts::echoMix),
+                         backend);
+    duplex.start();
+    backend->delay(consts::echoLengthMsec);
+    duplex.stop();
+  }
 
-  std::cout << "forward ";
-  playback.play(recording);
+  audio::DeviceCapture<float> capture(audio::Metadata(), audio::OverflowPolicy::Grow, backend);
+  const auto recording = std::make_shared<const audio::Sequence<float>>(
+        capture.record(consts::recordLengthMsec));
 
-  std::cout << "complete backward ";
-  auto completeBackward = recording;
-  for(auto&& samples : completeBackward.storage) {
-    std::reverse(std::begin(samples), std::end(samples));
-  }
-  std::reverse(std::begin(completeBackward.storage), std::end(completeBackward.storage));
-  playback.play(completeBackward);
+  audio::DevicePlayback<float> playback(recording->metadata, backend);
 
-  std::cout << "sample-wise backward (smoothed) ";
-  auto samplewiseBackward = recording;
-  for(auto&& samples : samplewiseBackward.storage) {
-    std::reverse(std::begin(samples), std::end(samples));
-  }
-  samplewiseBackward = audio::smooth(samplewiseBackward, 20);
-  playback.play(samplewiseBackward);
-
-  std::cout << "group-wise backward (smoothed) ";
-  auto&& groupwiseBackward = recording;
-  std::reverse(std::begin(groupwiseBackward.storage), std::end(groupwiseBackward.storage));
-  groupwiseBackward = audio::smooth(groupwiseBackward, 20);
-  playback.play(groupwiseBackward);
+  // queue all variants for gapless playback, processing the next while the previous plays;
+  // the reversed variants are lazy views on the shared recording
+  std::cout << "forward" << std::endl;
+  (void)playback.enqueue(recording);
+
+  std::cout << "complete backward" << std::endl;
+  (void)playback.enqueue(audio::reverse(*recording));
+
+  std::cout << "sample-wise backward (smoothed)" << std::endl;
+  (void)playback.enqueue(audio::smooth(audio::reverseWithinGroups(*recording), 20));
+
+  std::cout << "group-wise backward (smoothed)" << std::endl;
+  playback.wait(playback.enqueue(audio::smooth(audio::reverseGroups(*recording), 20)));
 
   return EXIT_SUCCESS;
 } catch (const std::exception& e) {
@@ -0,0 +1,144 @@
+#include "AudioDevice.h"
+#include "AudioGenerator.h"
+#include "AudioPeaks.h"
+#include "AudioSource.h"
+#include "AudioSpectrum.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace consts {
+  static const audio::Metadata metadata = {48000, 1, 256};
+
+  // linear chirp 200Hz ... 12kHz
+  static const double chirpStart = 200.0;
+  static const double chirpEnd = 12000.0;
+  static const std::chrono::duration<double> chirpLength(0.2);
+
+  // capture before the chirp starts and in total per run
+  static const std::chrono::milliseconds leadIn(200);
+  static const std::chrono::milliseconds recordLength(1000);
+  static const std::chrono::milliseconds captureBufferLength(2000);
+
+  static const size_t runCount = 5;
+  static const uint32_t pollIntervalMsec = 1;
+} // namespace consts
+
+using Clock = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+audio::Chirp makeChirp()
+{
+  return audio::Chirp(
+        consts::metadata.sampleRate,
+        consts::chirpStart,
+        consts::chirpEnd,
+        consts::chirpLength,
+        audio::ChirpShape::Linear);
+}
+
+/// capture while playing the chirp once
+/// @return  round trip from handing the chirp to the playback device
+///          until receiving it from the capture device
+Seconds measure(
+    audio::Backend& backend,
+    audio::DeviceCapture<float>& capture,
+    audio::DevicePlayback<float>& playback,
+    audio::SpectrumAnalyzer<float>& analyzer,
+    const std::vector<float>& reference)
+{
+  const auto sampleRate = static_cast<double>(consts::metadata.sampleRate);
+  const auto leadInSamples = static_cast<size_t>(consts::leadIn.count() * consts::metadata.sampleRate / 1000);
+  const auto recordSamples = static_cast<size_t>(consts::recordLength.count() * consts::metadata.sampleRate / 1000);
+
+  // the first pull by the playback callback marks when the chirp is handed to the device
+  std::atomic<Clock::rep> playbackStart(0);
+  bool isPulled = false;
+  auto chirp = audio::process(
+        audio::generatorSource(consts::metadata, makeChirp(), reference.size()),
+        [&playbackStart, isPulled](float*, size_t) mutable {
+    if(!isPulled) {
+      playbackStart = Clock::now().time_since_epoch().count();
+      isPulled = true;
+    }
+  });
+
+  // capture clock offset: each arrival bounds the time of its last sample from above
+  std::vector<float> recording(recordSamples);
+  double captureOffset = std::numeric_limits<double>::max(); // [s]
+  std::future<void> played;
+
+  capture.start(consts::captureBufferLength);
+  for(size_t done = 0; done < recordSamples;) {
+    const auto count = capture.tryRead(recording.data() + done, recordSamples - done);
+    if(count > 0) {
+      done += count;
+      const auto now = Seconds(Clock::now().time_since_epoch()).count();
+      captureOffset = std::min(captureOffset, now - static_cast<double>(done) / sampleRate);
+    }
+
+    if(!played.valid() && done >= leadInSamples) {
+      played = playback.enqueue(std::move(chirp));
+    }
+
+    backend.delay(consts::pollIntervalMsec);
+  }
+  capture.stop();
+  playback.wait(played);
+
+  // locate the chirp with sub-sample precision
+  const auto& correlation = analyzer.correlate(recording.data(), recording.size(), reference.data(), reference.size());
+  std::vector<float> magnitude(correlation.size());
+  (void)std::transform(
+        std::begin(correlation), std::end(correlation),
+        std::begin(magnitude),
+        [](float v) -> float { return std::abs(v); });
+  const auto peakBin = std::distance(
+        std::begin(magnitude),
+        std::max_element(std::begin(magnitude) + 1, std::end(magnitude) - 1));
+  const auto peak = audio::interpolatePeak(magnitude.data(), static_cast<uint32_t>(peakBin));
+
+  const auto captured = captureOffset + static_cast<double>(peak.bin) / sampleRate;
+  const auto handedOver = Seconds(Clock::duration(playbackStart.load())).count();
+  return Seconds(captured - handedOver);
+}
+
+int main(int, char**)
+try {
+  const auto backend = audio::defaultBackend();
+  audio::DeviceCapture<float> capture(consts::metadata, audio::OverflowPolicy::Grow, backend);
+  audio::DevicePlayback<float> playback(consts::metadata, backend);
+  audio::SpectrumAnalyzer<float> analyzer;
+
+  auto chirp = makeChirp();
+  std::vector<float> reference(chirp.size());
+  chirp.generate(reference.data(), reference.size());
+
+  std::vector<double> latencies; // [ms]
+  for(size_t run = 0; run < consts::runCount; ++run) {
+    latencies.push_back(1000 * measure(*backend, capture, playback, analyzer, reference).count());
+    std::cout << "run " << run + 1 << ": " << latencies.back() << "ms" << std::endl;
+  }
+
+  const auto mean = std::accumulate(std::begin(latencies), std::end(latencies), 0.0) / static_cast<double>(latencies.size());
+  double variance = 0.0;
+  for(auto&& latency : latencies) {
+    variance += (latency - mean) * (latency - mean);
+  }
+  variance /= static_cast<double>(latencies.size() > 1 ? latencies.size() - 1 : 1);
+
+  std::cout << "round trip latency " << mean << "ms, variance " << variance << "ms^2"
+            << " (standard deviation " << std::sqrt(variance) << "ms)" << std::endl;
+
+  return EXIT_SUCCESS;
+} catch (const std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return EXIT_FAILURE;
+}
@@ -1,117 +1,59 @@
-#include "SdlGuard.h"
-
-#define SDL_MAIN_HANDLED
-#include "SDL2/SDL.h"
+#include "AudioConvolver.h"
+#include "AudioDuplex.h"
 
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
-#include <stdexcept>
+#include <random>
+#include <vector>
 
 namespace consts {
-  static const int audioSpecFrequency = 48000;
-  static const SDL_AudioFormat audioSpecFormat = AUDIO_F32SYS;
-  static const uint8_t audioSpecChannels = 1;
-  static const uint8_t audioSpecSilence = 0;
-  static const uint16_t audioSpecSamples = 4096;
-  static const uint16_t audioSpecPadding = 0;
-  static const uint32_t audioSpecSize = 0;
-
-  static const int allowedAudioChange = 0;
+  static const audio::Metadata metadata = {48000, 1, 1024};
 
-  static const int pauseDisable = 0;
+  static const std::chrono::milliseconds targetLatency(50);
 
   static const uint32_t recordLengthMsec = 5000;
-} // namespace consts
-
-bool isValid(SDL_AudioDeviceID deviceId)
-{
-  return (deviceId >= 2); // see SDL_OpenAudioDevice()
-}
-
-void printAudioDevices(int isCapture)
-{
-  const int numAudioDevices = SDL_GetNumAudioDevices(isCapture);
-
-  std::cout << "Available audio " << (isCapture ? "capture" : "playback") << " devices:\n";
-  for(int i = 0; i < numAudioDevices; ++i)
-    std::cout << SDL_GetAudioDeviceName(i, isCapture) << "\n";
-  std::cout << "\n";
-}
-
-SDL_AudioDeviceID setupPlayDevice()
-{
-  static const int isCapture = SDL_FALSE;
-
-  printAudioDevices(isCapture);
-
-  const SDL_AudioSpec want = {
-    consts::audioSpecFrequency,  /**< DSP frequency -- samples per second */
-    consts::audioSpecFormat,     /**< Audio data format */
-    consts::audioSpecChannels,   /**< Number of channels: 1 mono, 2 stereo */
-    consts::audioSpecSilence,    /**< Audio buffer silence value (calculated) */
-    consts::audioSpecSamples,    /**< Audio buffer size in sample FRAMES (total samples divided by channel count) */
-    consts::audioSpecPadding,    /**< Necessary for some compile environments */
-    consts::audioSpecSize,       /**< Audio buffer size in bytes (calculated) */
-    nullptr,                     /**< Callback that feeds the audio device (NULL to use SDL_QueueAudio()). */
-    nullptr                      /**< Userdata passed to callback (ignored for NULL callbacks). */
-  };
-
-  SDL_AudioSpec have;
-  const auto deviceId = SDL_OpenAudioDevice(nullptr, isCapture, &want, &have, consts::allowedAudioChange);
-  if(!isValid(deviceId))
-    throw std::runtime_error(std::string("Failed to open audio: ") + SDL_GetError());
+  static const uint32_t reportIntervalMsec = 1000;
 
-  return deviceId;
-}
-
-void captureCallback(void* userdata, uint8_t* stream, int len)
-{
-  auto playDeviceId = *reinterpret_cast<const SDL_AudioDeviceID*>(userdata);
-
-  if(SDL_QueueAudio(playDeviceId, stream, static_cast<uint32_t>(len)))
-    throw std::runtime_error(std::string("Failed to queue audio: ") + SDL_GetError());
-}
+  // synthetic room: direct sound followed by a diffuse tail decaying by 60dB
+  static const double reverbTime = 0.8; // [s]
+  static const float reverbLevel = 0.05f;
+} // namespace consts
 
-SDL_AudioDeviceID setupCaptureDevice(SDL_AudioDeviceID* playDeviceId)
+/// impulse response of a room as exponentially decaying noise
+std::vector<float> roomResponse()
 {
-  static const int isCapture = SDL_TRUE;
-
-  printAudioDevices(isCapture);
-
-  const SDL_AudioSpec want = {
-    consts::audioSpecFrequency,  /**< DSP frequency -- samples per second */
-    consts::audioSpecFormat,     /**< Audio data format */
-    consts::audioSpecChannels,   /**< Number of channels: 1 mono, 2 stereo */
-    consts::audioSpecSilence,    /**< Audio buffer silence value (calculated) */
-    consts::audioSpecSamples,    /**< Audio buffer size in sample FRAMES (total samples divided by channel count) */
-    consts::audioSpecPadding,    /**< Necessary for some compile environments */
-    consts::audioSpecSize,       /**< Audio buffer size in bytes (calculated) */
-    captureCallback,             /**< Callback that feeds the audio device (NULL to use SDL_QueueAudio()). */
-    playDeviceId                 /**< Userdata passed to callback (ignored for NULL callbacks). */
-  };
-
-  SDL_AudioSpec have;
-  const auto deviceId = SDL_OpenAudioDevice(nullptr, isCapture, &want, &have, consts::allowedAudioChange);
-  if(!isValid(deviceId))
-    throw std::runtime_error(std::string("Failed to open audio: ") + SDL_GetError());
-
-  return deviceId;
+  const auto length = static_cast<size_t>(consts::reverbTime * consts::metadata.sampleRate);
+  const auto decay = std::log(1e-3) / static_cast<double>(length);
+
+  std::mt19937 generator;
+  std::normal_distribution<float> noise(0.f, consts::reverbLevel);
+  std::vector<float> response(length);
+  for(size_t i = 0; i < length; ++i) {
+    response[i] = noise(generator) * static_cast<float>(std::exp(decay * static_cast<double>(i)));
+  }
+  response[0] = 1.f;
+  return response;
 }
 
 int main(int, char**)
 try {
-  audio::SdlGuard SdlGuard;
-
-  auto playDeviceId = setupPlayDevice();
-  const auto captureDeviceId = setupCaptureDevice(&playDeviceId);
-
-  SDL_PauseAudioDevice(playDeviceId, consts::pauseDisable);
-  SDL_PauseAudioDevice(captureDeviceId, consts::pauseDisable);
-
-  SDL_Delay(consts::recordLengthMsec);
-
-  SDL_CloseAudioDevice(captureDeviceId);
-  SDL_CloseAudioDevice(playDeviceId);
+  // the reverb adds one block of latency on top of the jitter buffer
+  const auto backend = audio::defaultBackend();
+  audio::Duplex duplex(consts::metadata, consts::targetLatency, audio::Convolver(consts::metadata, roomResponse()), backend);
+  duplex.start();
+
+  for(uint32_t elapsed = 0; elapsed < consts::recordLengthMsec; elapsed += consts::reportIntervalMsec) {
+    backend->delay(consts::reportIntervalMsec);
+
+    const auto stats = duplex.stats();
+    std::cout << "latency " << stats.latency.count() / 1000.0 << "ms"
+              << ", ratio " << stats.ratio
+              << ", underruns " << stats.underruns
+              << ", overruns " << stats.overruns << std::endl;
+  }
+
+  duplex.stop();
 
   return EXIT_SUCCESS;
 } catch(const std::exception& e) {
@@ -0,0 +1,55 @@
+#include "AudioDevice.h"
+#include "AudioFile.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace consts {
+  static const audio::Metadata metadata;
+
+  static const std::string path = "recording.wav";
+  static const uint32_t recordLengthMsec = 5000;
+  static const uint32_t pollIntervalMsec = 100; // well within the capture buffer length
+} // namespace consts
+
+/// stream the capture straight to disk; memory use does not depend on the recording length
+void record(const std::shared_ptr<audio::Backend>& backend)
+{
+  audio::DeviceCapture<float> capture(consts::metadata, audio::OverflowPolicy::Grow, backend);
+  audio::FileWriter<float> writer(consts::path, consts::metadata);
+
+  capture.start();
+  const auto begin = backend->ticks();
+  while(backend->ticks() - begin < consts::recordLengthMsec) {
+    backend->delay(consts::pollIntervalMsec);
+    (void)writer.pull(capture);
+  }
+  capture.stop();
+  (void)writer.pull(capture);
+  writer.close();
+
+  if(capture.overruns() + writer.overruns() > 0) {
+    std::cerr << "lost " << capture.overruns() + writer.overruns() << " samples" << std::endl;
+  }
+}
+
+int main(int, char**)
+try {
+  const auto backend = audio::defaultBackend();
+
+  std::cout << "recording to " << consts::path << "..." << std::endl;
+  record(backend);
+
+  // play back from the mapped file without loading it
+  const auto recording = audio::mapWav<float>(consts::path, consts::metadata.sampleCount);
+  std::cout << "playing back " << recording.duration().count() << "ms..." << std::endl;
+
+  audio::DevicePlayback<float> playback(recording.metadata, backend);
+  playback.wait(playback.enqueue(recording));
+
+  return EXIT_SUCCESS;
+} catch (const std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return EXIT_FAILURE;
+}
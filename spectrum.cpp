@@ -1,7 +1,9 @@
-#include "Algo.h"
+#include "AudioChannels.h"
 #include "AudioDevice.h"
-
-#include "kissfft/kissfft.hh"
+#include "AudioGenerator.h"
+#include "AudioPeaks.h"
+#include "AudioSpectrum.h"
+#include "AudioTones.h"
 
 #include <algorithm>
 #include <cassert>
@@ -9,128 +11,131 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 //#define DEBUG_SINE_FREQUENCY 500.0F
 
 namespace consts {
   static const std::chrono::milliseconds recordLength(2000);
+  static const float densityFloor = 1e-20f; // lower bound for the logarithmic spectrum
+  static const size_t historyLength = 16; // number of live spectrogram frames kept
+  static const std::vector<float> watchedTones = {440.f, 1000.f, 2000.f}; // [Hz]
+  static const float toneThreshold = 0.1f; // minimum amplitude of a detected tone
 } // namespace consts
 
-audio::Sequence<float> sineSequence(float freq, std::chrono::seconds length)
+/// backend of the capture and playback devices; a headless one capturing a sine
+/// runs the whole pipeline faster than real time without a sound card
+std::shared_ptr<audio::Backend> backend()
+{
+#ifndef DEBUG_SINE_FREQUENCY
+  return audio::defaultBackend();
+#else
+  const audio::Metadata metadata;
+  std::shared_ptr<audio::Source<float>> sine = audio::generatorSource(
+        metadata, audio::Oscillator(metadata.sampleRate, DEBUG_SINE_FREQUENCY));
+  return std::make_shared<audio::OfflineBackend>(audio::sourceReader(sine));
+#endif // DEBUG_SINE_FREQUENCY
+}
+
+/// logarithmic copy of a power spectral density [dB]
+void toDecibels(const std::vector<float>& density, std::vector<float>& decibels)
+{
+  decibels.resize(density.size());
+  (void)std::transform(
+        std::begin(density), std::end(density),
+        std::begin(decibels),
+        [](float v) -> float { return 10.f * std::log10(std::max(v, consts::densityFloor)); });
+}
+
+/// record while tracking the partials of the live spectrogram
+audio::Sequence<float> monitor(std::chrono::milliseconds length, std::shared_ptr<audio::Backend> backend)
 {
   audio::Sequence<float> seq;
+  const auto& metadata = seq.metadata;
+
+  audio::Stft<float> stft(metadata, metadata.sampleCount, metadata.sampleCount / 2, consts::historyLength);
+  audio::PeakTracker tracker(metadata, metadata.sampleCount);
+  audio::ToneDetector detector(metadata, consts::watchedTones, metadata.sampleCount);
+  std::vector<float> group(metadata.groupSize());
+  std::vector<float> decibels;
+
+  audio::DeviceCapture<float> capture(metadata, audio::OverflowPolicy::Grow, std::move(backend));
+  capture.start();
+
+  const auto groupCount = length.count() * metadata.sampleRate / 1000 / metadata.sampleCount;
+  for(auto i = 0; i < groupCount; ++i) {
+    const auto count = capture.read(group.data(), group.size());
+
+    // the device stream is interleaved, capture groups are planar
+    const auto frames = count / metadata.channelCount;
+    audio::Sequence<float>::Samples planar(frames * metadata.channelCount);
+    audio::deinterleave(group.data(), frames, metadata.channelCount, planar.data(), frames);
+    seq.push(std::move(planar));
+
+    // follow the partials through every new frame
+    const auto frameCount = stft.push(group.data(), count);
+    for(auto age = frameCount; age > 0; --age) {
+      toDecibels(stft.frame(age - 1), decibels);
+      (void)tracker.update(decibels);
+    }
 
-  // time accumulator
-  float t = 0.f; // [s]
-  const float dT = 1.0F / seq.metadata.sampleCount; // [s]
+    // check the known tones without a full transform
+    (void)detector.push(group.data(), count, [&](const std::vector<float>& amplitudes) {
+      for(size_t t = 0; t < amplitudes.size(); ++t) {
+        if(amplitudes[t] > consts::toneThreshold) {
+          std::cout << "tone " << detector.frequencies()[t] << "Hz at amplitude " << amplitudes[t] << std::endl;
+        }
+      }
+    });
 
-  const auto sampleCount = seq.metadata.sampleRate * length.count() / seq.metadata.sampleCount;
-  for(uint32_t i = 0U; i < sampleCount; ++i) {
-    std::vector<float> values(seq.metadata.sampleCount);
-    for(auto&& value : values) {
-      value = std::sin(2 * static_cast<float>(M_PI) * freq * t);
-      t += dT;
+    if(frameCount > 0 && !tracker.tracks().empty()) {
+      const auto& strongest = tracker.tracks().front();
+      std::cout << "live track " << strongest.id << " at " << strongest.frequency << "Hz" << std::endl;
     }
-    seq.push(std::move(values));
+  }
+
+  capture.stop();
+  if(capture.overruns() > 0) {
+    std::cerr << "lost " << capture.overruns() << " samples" << std::endl;
   }
 
   return seq;
 }
 
-std::vector<float> fft(const audio::Sequence<float>& seq)
+template<typename Source>
+std::vector<float> psd(const Source& seq)
 {
-  const size_t halfSize = seq.metadata.sampleCount / 2;
-
-  std::vector<float> ret(halfSize);
-
-  std::vector<kissfft<float>::cpx_t> transformedSum(halfSize);
-  {
-    kissfft<float> calc(halfSize, false);
-
-    (void)std::for_each(
-          std::begin(seq.storage), std::end(seq.storage),
-          [&](const std::vector<float>& samples) {
-      // calculate FFT (complex) for (real) samples
-      std::vector<kissfft<float>::cpx_t> transformed(halfSize);
-      calc.transform_real(samples.data(), transformed.data());
-
-      // sum up (complex)
-      (void)std::transform(
-            std::begin(transformed), std::end(transformed),
-            std::begin(transformedSum), std::begin(transformedSum),
-            std::plus<kissfft<float>::cpx_t>());
-    });
-  }
-
-  // calculate absolute of complex FFT results
-  (void)std::transform(
-        std::begin(transformedSum), std::end(transformedSum),
-        std::begin(ret),
-        [](const kissfft<float>::cpx_t& v) -> float { return std::abs(v); });
+  // Welch estimate over Hann-windowed, half-overlapping segments of one group length
+  const size_t segmentSize = seq.metadata.sampleCount;
+  const auto density = audio::welch(seq.channel(0), segmentSize, segmentSize / 2, audio::Window::Hann);
 
-  return ret;
+  std::vector<float> decibels;
+  toDecibels(density, decibels);
+  return decibels;
 }
 
 void analyze(const std::vector<float>& spectrum, const audio::Metadata& metadata)
 {
-  // filter some minor peaks
-  const auto smoothedSpectrum = audio::smooth(spectrum, 5);
-
-  static const float thresh = 10.f;
-
-  bool wasRising = true;
-  float min = 0.f;
-  float max = 0.f;
-  auto pos = std::begin(smoothedSpectrum);
-  while (pos != std::end(smoothedSpectrum)) {
-    pos = std::adjacent_find(
-          pos, std::end(smoothedSpectrum),
-          [&](float lhs, float rhs) -> bool {
-      const bool isRising = (lhs < rhs);
-
-      if(wasRising && !isRising) { // peak
-        wasRising = isRising;
-        max = lhs;
-        if(max - min > thresh) {
-          return true;
-        }
-      } else if(!wasRising && isRising) { // valley
-        wasRising = isRising;
-        if(max - min > thresh)
-          min = lhs;
-      }
-      return false;
-    });
-
-    auto peakOffset = std::distance(std::begin(smoothedSpectrum), pos);
-
-    // frequency calculation from spectrum position
-    // inspired by https://stackoverflow.com/a/4230658
-    auto peakFreq = metadata.sampleRate * peakOffset / metadata.sampleCount;
-
-    std::cout << "spectrum peak at " << peakFreq << "Hz" << std::endl;
+  audio::PeakTracker tracker(metadata, metadata.sampleCount);
+  for(auto&& track : tracker.update(spectrum)) {
+    std::cout << "spectrum peak at " << track.frequency << "Hz (" << track.level << "dB)" << std::endl;
   }
 }
 
 int main(int, char**)
 try {
-  // record / generate
-#ifndef DEBUG_SINE_FREQUENCY
-  audio::DeviceCapture<float> capture;
-  auto seq = capture.record(consts::recordLength);
-#else
-  auto seq = sineSequence(
-        DEBUG_SINE_FREQUENCY,
-        std::chrono::duration_cast<std::chrono::seconds>(
-          consts::recordLength));
-#endif // DEBUG_SINE_FREQUENCY
+  const auto devices = backend();
+
+  // record
+  auto seq = monitor(consts::recordLength, devices);
 
   // play back
-  audio::DevicePlayback<float> play(seq.metadata);
+  audio::DevicePlayback<float> play(seq.metadata, devices);
   play.play(seq);
 
   // calculate spectrum
-  const auto spectrum = fft(seq);
+  const auto spectrum = psd(seq);
 
   // print spectrum characteristics
   analyze(spectrum, seq.metadata);
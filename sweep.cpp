@@ -1,118 +1,76 @@
 #include "AudioDevice.h"
+#include "AudioGenerator.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 
 namespace consts {
   constexpr audio::Metadata metadata;
 
-  // sample duration
-  static const float dT = 1 / static_cast<float>(metadata.sampleRate);
-
   // sweep 20Hz ... 20kHz
-  static const float fMin = 20.f;
-  static const float fMax = 20000.f;
-  static const float sweepFactor = 1.1f;
-} // namespace consts
-
-audio::Sequence<float> sweepNaive()
-{
-  audio::Sequence<float> seq{consts::metadata};
-
-  // time accumulator
-  float t = 0.f;
-
-  float values[consts::metadata.sampleCount];
-
-  for(float freq = consts::fMin; freq < consts::fMax; freq *= consts::sweepFactor) {
-    for(auto&& value : values) {
-      value = std::sin(2 * static_cast<float>(M_PI) * freq * t);
-      t += consts::dT;
-    }
+  static const double fMin = 20.0;
+  static const double fMax = 20000.0;
+  static const double sweepFactor = 1.1;
 
-    seq.push(std::begin(values), std::end(values));
-  }
-
-  return seq;
-}
+  // each chirp lasts as long as the stepped sweep
+  static const std::chrono::duration<double> chirpLength(
+    std::log(fMax / fMin) / std::log(sweepFactor) * metadata.sampleCount / metadata.sampleRate);
+} // namespace consts
 
-audio::Sequence<float> sweepTimeAccumulator()
+/// oscillator stepping up its frequency after each capture group
+struct SteppedSweep
 {
-  audio::Sequence<float> seq{consts::metadata};
-
-  // time accumulator
-  float t = 0.f;
-
-  // phase continuity offset
-  // recalculated on each frequency update to guarantee continuous phase and smooth audio transition
-  // inspired by https://dsp.stackexchange.com/q/971
-  float phiOffset = 0.f;
-
-  float values[consts::metadata.sampleCount];
+  audio::Oscillator oscillator{consts::metadata.sampleRate, consts::fMin};
+  size_t stepRemaining = consts::metadata.sampleCount;
 
-  float freq = consts::fMin;
-  while (freq < consts::fMax)
+  void generate(float* dst, size_t count)
   {
-    // cache the last phi of this frequency
-    float phi = 0.f;
-
-    for(auto&& value : values) {
-      phi = 2 * static_cast<float>(M_PI) * freq * t + phiOffset;
-      value = std::sin(phi);
-      t += consts::dT;
+    while(count > 0) {
+      const auto n = std::min(count, stepRemaining);
+      oscillator.generate(dst, n);
+      dst += n;
+      count -= n;
+
+      // the oscillator keeps the phase continuous on each frequency step
+      stepRemaining -= n;
+      if(stepRemaining == 0) {
+        oscillator.setFrequency(oscillator.frequency() * consts::sweepFactor);
+        stepRemaining = consts::metadata.sampleCount;
+      }
     }
-
-    seq.push(std::begin(values), std::end(values));
-
-    const auto nextFreq = freq * consts::sweepFactor;
-
-    // recalculate phase continuity offset
-    phiOffset = phi - nextFreq * (t - consts::dT);
-
-    freq = nextFreq;
   }
+};
 
-  return seq;
+std::unique_ptr<audio::Source<float>> sweepStepped()
+{
+  const auto stepCount = static_cast<size_t>(std::ceil(std::log(consts::fMax / consts::fMin) / std::log(consts::sweepFactor)));
+  return audio::generatorSource(consts::metadata, SteppedSweep(), stepCount * consts::metadata.sampleCount);
 }
 
-audio::Sequence<float> sweepPhaseAccumulator()
+std::unique_ptr<audio::Source<float>> sweepChirp(audio::ChirpShape shape)
 {
-  audio::Sequence<float> seq{consts::metadata};
-
-  // phase accumulator
-  // to guarantee continuous phase and smooth audio transition
-  // note: mind numeric inaccuracies depending on duration and frequency
-  float phi = 0.f;
-
-  float values[consts::metadata.sampleCount];
-
-  for(float freq = consts::fMin; freq < consts::fMax; freq *= consts::sweepFactor) {
-    const auto deltaPhi = 2 * static_cast<float>(M_PI) * freq * consts::dT;
-
-    for(auto&& value : values) {
-      value = std::sin(phi);
-      phi += deltaPhi;
-    }
-
-    seq.push(std::begin(values), std::end(values));
-  }
-
-  return seq;
+  audio::Chirp chirp(consts::metadata.sampleRate, consts::fMin, consts::fMax, consts::chirpLength, shape);
+  const auto frameCount = chirp.size();
+  return audio::generatorSource(consts::metadata, std::move(chirp), frameCount);
 }
 
 int main(int, char**)
 try {
   audio::DevicePlayback<float> playback(consts::metadata);
 
-  std::cout << "simple sweep..." << std::endl;
-  playback.play(sweepNaive());
+  // queue all sweeps for gapless playback; each is rendered on demand by the device callback
+  std::cout << "stepped sweep..." << std::endl;
+  (void)playback.enqueue(sweepStepped());
 
-  std::cout << "sweep generated using time accumulator..." << std::endl;
-  playback.play(sweepTimeAccumulator());
+  std::cout << "linear chirp..." << std::endl;
+  (void)playback.enqueue(sweepChirp(audio::ChirpShape::Linear));
 
-  std::cout << "sweep generated using phase accumulator..." << std::endl;
-  playback.play(sweepPhaseAccumulator());
+  std::cout << "exponential chirp..." << std::endl;
+  playback.wait(playback.enqueue(sweepChirp(audio::ChirpShape::Exponential)));
 
   return EXIT_SUCCESS;
 } catch (const std::exception& e) {